@@ -0,0 +1,674 @@
+#include "Benchmarks.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Timing.h"
+#include "stb_image.h"
+
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <thread>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+static glm::mat4 benchmarkModel(unsigned int i) {
+	// spread the cubes on a grid so the matrices aren't trivially identical
+	glm::vec3 position((float)(i % 100) * 2.0f, (float)((i / 100) % 100) * 2.0f, -(float)(i / 10000) * 2.0f);
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+	return glm::rotate(model, 20.0f * i, glm::vec3(1.0f, 0.3f, 0.5f));
+}
+
+void runInstancingBenchmark(unsigned int cubeVAO, InstanceBuffer& instanceBuffer, unsigned int perCubeProgram, unsigned int instancedProgram, GLStateCache& stateCache) {
+	std::cout << "BENCHMARK::INSTANCING (CPU submit time, ms)" << std::endl;
+	std::cout << std::setw(10) << "instances" << std::setw(14) << "per-cube" << std::setw(14) << "instanced" << std::setw(10) << "speedup" << std::endl;
+
+	std::vector<glm::mat4> models;
+
+	// warm up both programs so first-use driver work (shader variants, buffer allocation) isn't timed
+	stateCache.bindVertexArray(cubeVAO);
+	stateCache.useProgram(perCubeProgram);
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+	stateCache.useProgram(instancedProgram);
+	glm::mat4 identity(1.0f);
+	instanceBuffer.upload(stateCache, &identity, 1);
+	instanceBuffer.drawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+
+	for (unsigned int count = 10; count <= 1000000; count *= 10) {
+		glFinish();
+
+		// current path: one matrix build, uniform lookup + upload and draw call per cube
+		stateCache.useProgram(perCubeProgram);
+		stateCache.bindVertexArray(cubeVAO);
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < count; i++) {
+			glm::mat4 model = benchmarkModel(i);
+			int modelLoc = glGetUniformLocation(perCubeProgram, "model");
+			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+			glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		}
+		double perCubeMs = elapsedMs(start);
+		glFinish();
+
+		// instanced path: build all matrices, one buffer upload and one draw call
+		stateCache.useProgram(instancedProgram);
+		start = std::chrono::steady_clock::now();
+		models.resize(count);
+		for (unsigned int i = 0; i < count; i++) {
+			models[i] = benchmarkModel(i);
+		}
+		instanceBuffer.upload(stateCache, models.data(), count);
+		instanceBuffer.drawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		double instancedMs = elapsedMs(start);
+		glFinish();
+
+		std::cout << std::setw(10) << count << std::setw(14) << std::fixed << std::setprecision(3) << perCubeMs
+			<< std::setw(14) << instancedMs << std::setw(9) << std::setprecision(1) << perCubeMs / instancedMs << "x" << std::endl;
+	}
+
+	stateCache.bindVertexArray(0);
+}
+
+void runRenderQueueBenchmark(unsigned int cubeVAO, InstanceBuffer& instanceBuffer, unsigned int instancedProgram, unsigned int texture1, unsigned int texture2, GLStateCache& stateCache) {
+	const int itemCount = 500000;
+	const int materialCount = 16;
+	const int frameCount = 10;
+
+	RenderQueue queue;
+	queue.reserve(itemCount);
+	for (int i = 0; i < materialCount; i++) {
+		RenderMaterial material;
+		material.textures[0] = i % 2 ? texture1 : texture2;
+		material.textures[1] = i % 2 ? texture2 : texture1;
+		material.textureCount = 2;
+		queue.addMaterial(material);
+	}
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> depthDistribution(0.1f, 100.0f);
+	std::vector<float> depths(itemCount);
+	std::vector<glm::mat4> models(itemCount);
+	for (int i = 0; i < itemCount; i++) {
+		depths[i] = depthDistribution(random);
+		models[i] = benchmarkModel(i);
+	}
+
+	std::cout << "BENCHMARK::RENDER_QUEUE (" << itemCount << " items, budget " << RENDER_QUEUE_BUDGET_MS << " ms)" << std::endl;
+	std::cout << std::setw(8) << "frame" << std::setw(12) << "record" << std::setw(12) << "sort" << std::setw(12) << "submit"
+		<< std::setw(12) << "upload" << std::setw(12) << "draws" << std::endl;
+
+	double worstSortMs = 0.0;
+	double worstSubmitMs = 0.0;
+	double worstBudgetMs = 0.0;
+	double worstUploadMs = 0.0;
+	stateCache.invalidate();
+	for (int frame = 0; frame < frameCount; frame++) {
+		glFinish();
+		auto start = std::chrono::steady_clock::now();
+		queue.clear();
+		for (int i = 0; i < itemCount; i++) {
+			DrawItem item = { instancedProgram, cubeVAO, (unsigned int)(i % materialCount), GL_TRIANGLES, 0, 36, UniformCache::INVALID_HANDLE, &instanceBuffer, true };
+			queue.push(PASS_OPAQUE, depths[i], item, models[i]);
+		}
+		double recordMs = elapsedMs(start);
+		queue.sort();
+		queue.submit(stateCache);
+		worstSortMs = std::max(worstSortMs, queue.getLastSortMs());
+		worstSubmitMs = std::max(worstSubmitMs, queue.getLastSubmitMs());
+		worstBudgetMs = std::max(worstBudgetMs, queue.getLastSortMs() + queue.getLastSubmitMs());
+		worstUploadMs = std::max(worstUploadMs, queue.getLastUploadMs());
+
+		std::cout << std::setw(8) << frame << std::fixed << std::setprecision(3) << std::setw(12) << recordMs << std::setw(12) << queue.getLastSortMs()
+			<< std::setw(12) << queue.getLastSubmitMs() << std::setw(12) << queue.getLastUploadMs() << std::setw(12) << queue.getLastDrawCalls() << std::endl;
+	}
+	// the budget covers sorting and issuing state changes and draws; the instance matrices are data the
+	// frame has to move whatever order it draws in, so their upload is reported but not budgeted
+	std::cout << "worst sort " << worstSortMs << " ms, worst submit " << worstSubmitMs << " ms, worst sort + submit " << worstBudgetMs << " ms: "
+		<< (worstBudgetMs <= RENDER_QUEUE_BUDGET_MS ? "within" : "NOT within") << " the " << RENDER_QUEUE_BUDGET_MS << " ms budget" << std::endl;
+	std::cout << "not budgeted: worst instance upload " << worstUploadMs << " ms for " << queue.getLastUploadBytes() / (1024 * 1024) << " MB of matrices" << std::endl;
+	glFinish();
+}
+
+void runMultiDrawBenchmark(unsigned int instancedProgram, GLStateCache& stateCache) {
+	const unsigned int meshCount = 1000;
+	const int frameCount = 5;
+	static const char* pathNames[] = { "multi-draw indirect", "base instance loop", "base vertex loop" };
+
+	// distinct meshes: boxes with different proportions, 8 corners and 12 triangles each
+	MeshBatch batch;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> sizeDistribution(0.2f, 1.0f);
+	const unsigned int boxIndices[36] = {
+		0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4, 0, 4, 7, 7, 3, 0,
+		1, 5, 6, 6, 2, 1, 3, 2, 6, 6, 7, 3, 0, 1, 5, 5, 4, 0
+	};
+	for (unsigned int mesh = 0; mesh < meshCount; mesh++) {
+		glm::vec3 size(sizeDistribution(random), sizeDistribution(random), sizeDistribution(random));
+		float boxVertices[8 * MeshBatch::FLOATS_PER_VERTEX];
+		for (int corner = 0; corner < 8; corner++) {
+			float* vertex = &boxVertices[corner * MeshBatch::FLOATS_PER_VERTEX];
+			vertex[0] = (corner & 1) ? size.x : -size.x;
+			vertex[1] = (corner & 2) ? size.y : -size.y;
+			vertex[2] = (corner & 4) ? size.z : -size.z;
+			vertex[3] = (corner & 1) ? 1.0f : 0.0f;
+			vertex[4] = (corner & 2) ? 1.0f : 0.0f;
+		}
+		batch.addMesh(boxVertices, 8, boxIndices, 36);
+	}
+	batch.finalize(stateCache);
+
+	std::vector<glm::mat4> models(meshCount);
+	for (unsigned int i = 0; i < meshCount; i++) {
+		models[i] = benchmarkModel(i);
+	}
+
+	std::cout << "BENCHMARK::MULTI_DRAW (" << meshCount << " distinct meshes)" << std::endl;
+	glUseProgram(instancedProgram);
+	stateCache.invalidate();
+	for (int path = MULTI_DRAW_INDIRECT; path <= MULTI_DRAW_BASE_VERTEX; path++) {
+		batch.setPath((MultiDrawPath)path);
+		if (batch.getPath() != path) {
+			std::cout << std::setw(22) << pathNames[path] << ": not supported" << std::endl;
+			continue;
+		}
+		double bestMs = 1e9;
+		for (int frame = 0; frame < frameCount; frame++) {
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			batch.clear();
+			for (unsigned int mesh = 0; mesh < meshCount; mesh++) {
+				batch.add(mesh, &models[mesh], 1);
+			}
+			batch.submit(stateCache);
+			bestMs = std::min(bestMs, elapsedMs(start));
+		}
+		std::cout << std::setw(22) << pathNames[path] << ": " << std::fixed << std::setprecision(3) << bestMs << " ms, "
+			<< batch.getLastApiCalls() << " GL calls" << std::endl;
+	}
+	glFinish();
+	batch.destroy();
+	stateCache.invalidate();
+}
+
+void runFrustumCullingBenchmark() {
+	const size_t sphereCount = 1000000;
+	const int runCount = 20;
+
+	BoundingSpheres spheres;
+	spheres.reserve(sphereCount);
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+	for (size_t i = 0; i < sphereCount; i++) {
+		spheres.add(glm::vec3(position(random), position(random), position(random)), radius(random));
+	}
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	Frustum frustum = Frustum::fromViewProjection(projection * view);
+
+	// scalar reference the SIMD results have to match
+	std::vector<unsigned int> expected;
+	for (size_t i = 0; i < sphereCount; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			inside = plane.x * spheres.centerX[i] + plane.y * spheres.centerY[i] + plane.z * spheres.centerZ[i] + plane.w >= -spheres.radius[i];
+		}
+		if (inside) {
+			expected.push_back((unsigned int)i);
+		}
+	}
+
+	std::cout << "BENCHMARK::FRUSTUM_CULLING (" << sphereCount << " spheres, " << expected.size() << " visible)" << std::endl;
+	unsigned int coreCount = std::max(1u, std::thread::hardware_concurrency());
+	FrustumCuller culler;
+	std::vector<unsigned int> visible;
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < coreCount; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(coreCount);
+
+	for (unsigned int threads : threadCounts) {
+		culler.setThreadCount(threads);
+		double bestMs = 1e9;
+		for (int run = 0; run < runCount; run++) {
+			bestMs = std::min(bestMs, culler.cull(frustum, spheres, visible).milliseconds);
+		}
+		std::cout << std::setw(4) << threads << " thread(s): " << std::fixed << std::setprecision(3) << bestMs << " ms"
+			<< (visible == expected ? "" : "  MISMATCH against scalar reference") << std::endl;
+	}
+}
+
+void runGpuCullingBenchmark(ShaderLoader& shaderLoader) {
+	const size_t sphereCount = 1000000;
+	const int runCount = 20;
+
+	GpuCuller gpuCuller;
+	if (!gpuCuller.create(shaderLoader)) {
+		std::cout << "BENCHMARK::GPU_CULLING skipped, the context has no compute shaders" << std::endl;
+		return;
+	}
+
+	// spheres from the same distributions and the same camera as the CPU benchmark
+	BoundingSpheres spheres;
+	spheres.reserve(sphereCount);
+	std::vector<glm::mat4> models;
+	models.reserve(sphereCount);
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+	for (size_t i = 0; i < sphereCount; i++) {
+		glm::vec3 center(position(random), position(random), position(random));
+		spheres.add(center, radius(random));
+		models.push_back(glm::translate(glm::mat4(1.0f), center));
+	}
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	Frustum frustum = Frustum::fromViewProjection(projection * view);
+
+	FrustumCuller cpuCuller;
+	std::vector<unsigned int> expected;
+	double cpuMs = 1e9;
+	for (int run = 0; run < runCount; run++) {
+		cpuMs = std::min(cpuMs, cpuCuller.cull(frustum, spheres, expected).milliseconds);
+	}
+
+	gpuCuller.setInstances(spheres, models.data());
+	// warm up, so the first dispatch's shader and buffer setup isn't timed
+	gpuCuller.cull(frustum);
+	glFinish();
+
+	double submitMs = 1e9;
+	double finishedMs = 1e9;
+	for (int run = 0; run < runCount; run++) {
+		auto start = std::chrono::steady_clock::now();
+		gpuCuller.cull(frustum);
+		glFinish();
+		finishedMs = std::min(finishedMs, elapsedMs(start));
+		submitMs = std::min(submitMs, gpuCuller.getLastSubmitMs());
+	}
+
+	std::vector<unsigned int> visible;
+	gpuCuller.readVisible(visible);
+	gpuCuller.destroy();
+
+	std::cout << "BENCHMARK::GPU_CULLING (" << sphereCount << " spheres, " << visible.size() << " visible)" << std::endl;
+	std::cout << std::fixed << std::setprecision(3) << "  submit " << submitMs << " ms, until finished " << finishedMs
+		<< " ms, CPU culler on all cores " << cpuMs << " ms"
+		<< (visible == expected ? "" : "  MISMATCH against the CPU culler") << std::endl;
+}
+
+void runTextureLoadingBenchmark() {
+	const char* paths[] = { "Textures/container.jpg", "Textures/awesomeface.png", "Textures/wall.jpg" };
+	const int copies = 32;
+	const int imageCount = copies * 3;
+
+	unsigned int scratch;
+	glGenTextures(1, &scratch);
+	glBindTexture(GL_TEXTURE_2D, scratch);
+	// summed rather than chained, so the order the workers finish in doesn't change it
+	unsigned long long pixelChecksum = 0;
+	size_t pixelCount = 0;
+	auto uploadScratch = [&pixelChecksum, &pixelCount](const DecodedImage& image) {
+		if (image.pixels) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+			pixelChecksum += hashBytes(FNV_OFFSET_BASIS, image.pixels, (size_t)image.width * image.height * 4);
+			pixelCount += (size_t)image.width * image.height;
+		}
+	};
+
+	// the old path: read and decode each file on the GL thread, then upload it
+	stbi_set_flip_vertically_on_load(true);
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < imageCount; i++) {
+		DecodedImage image = {};
+		int channels;
+		unsigned char* pixels = stbi_load(paths[i % 3], &image.width, &image.height, &channels, 4);
+		image.channels = 4;
+		image.pixels = pixels;
+		uploadScratch(image);
+		stbi_image_free(pixels);
+	}
+	glFinish();
+	double serialMs = elapsedMs(start);
+	unsigned long long expectedChecksum = pixelChecksum;
+	double megapixels = pixelCount / 1e6;
+
+	std::cout << "BENCHMARK::TEXTURE_LOADING (" << imageCount << " images, " << std::fixed << std::setprecision(1) << megapixels
+		<< " megapixels, end to end)" << std::endl;
+	std::cout << std::setw(10) << "workers" << std::setw(12) << "ms" << std::setw(10) << "MP/s" << std::setw(10) << "speedup" << std::endl;
+	std::cout << std::setw(10) << "serial" << std::setprecision(2) << std::setw(12) << serialMs << std::setw(10) << megapixels * 1000.0 / serialMs
+		<< std::setw(10) << 1.0 << std::endl;
+
+	unsigned int coreCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> workerCounts;
+	for (unsigned int workers = 1; workers < coreCount; workers *= 2) {
+		workerCounts.push_back(workers);
+	}
+	workerCounts.push_back(coreCount);
+
+	for (unsigned int workers : workerCounts) {
+		TextureLoader loader;
+		loader.start(workers);
+		pixelChecksum = 0;
+		glFinish();
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < imageCount; i++) {
+			loader.request(paths[i % 3], 4, true, uploadScratch);
+		}
+		loader.finish();
+		glFinish();
+		double loadMs = elapsedMs(start);
+		std::cout << std::setw(10) << workers << std::setw(12) << loadMs << std::setw(10) << megapixels * 1000.0 / loadMs
+			<< std::setw(10) << serialMs / loadMs << (pixelChecksum == expectedChecksum ? "" : "  MISMATCH against serial loading") << std::endl;
+	}
+	glDeleteTextures(1, &scratch);
+}
+
+void runTextureStreamingBenchmark() {
+	const char* paths[] = { "Textures/container.jpg", "Textures/awesomeface.png", "Textures/wall.jpg" };
+	const int textureCount = 96;
+	const size_t ringBytes = 8 * 1024 * 1024;
+	const size_t budgetBytes = 2 * 1024 * 1024;
+
+	struct SourceImage {
+		int width, height;
+		unsigned char* pixels;
+	};
+	SourceImage images[3];
+	stbi_set_flip_vertically_on_load(true);
+	for (int i = 0; i < 3; i++) {
+		int channels;
+		images[i].pixels = stbi_load(paths[i], &images[i].width, &images[i].height, &channels, 4);
+	}
+
+	std::vector<unsigned int> textures(textureCount);
+	glGenTextures(textureCount, textures.data());
+
+	// everything in one frame, the way the renderer used to upload
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < textureCount; i++) {
+		const SourceImage& image = images[i % 3];
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+	}
+	glFinish();
+	double directMs = elapsedMs(start);
+
+	// the same uploads streamed; the pixels stay owned by images, so no release function
+	TextureUploader uploader;
+	uploader.create(ringBytes, budgetBytes);
+	for (int i = 0; i < textureCount; i++) {
+		const SourceImage& image = images[i % 3];
+		uploader.queue(textures[i], GL_RGBA8, image.width, image.height, 4, image.pixels, nullptr, false);
+	}
+	int frames = 0;
+	double worstFrameMs = 0.0;
+	double totalMs = 0.0;
+	while (uploader.getQueuedCount() > 0) {
+		start = std::chrono::steady_clock::now();
+		uploader.update();
+		glFinish();
+		double frameMs = elapsedMs(start);
+		worstFrameMs = std::max(worstFrameMs, frameMs);
+		totalMs += frameMs;
+		frames++;
+	}
+
+	int mismatches = 0;
+	std::vector<unsigned char> readBack;
+	for (int i = 0; i < textureCount; i++) {
+		const SourceImage& image = images[i % 3];
+		readBack.resize((size_t)image.width * image.height * 4);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, readBack.data());
+		mismatches += memcmp(readBack.data(), image.pixels, readBack.size()) != 0 ? 1 : 0;
+	}
+	TextureUploadStats stats = uploader.getStats();
+	uploader.destroy();
+	glDeleteTextures(textureCount, textures.data());
+	for (int i = 0; i < 3; i++) {
+		stbi_image_free(images[i].pixels);
+	}
+
+	std::cout << "BENCHMARK::TEXTURE_STREAMING (" << textureCount << " textures, " << stats.bytesUploaded / (1024 * 1024) << " MB, "
+		<< ringBytes / (1024 * 1024) << " MB ring, " << budgetBytes / (1024 * 1024) << " MB per frame"
+		<< (uploader.isPersistent() ? ", persistent" : "") << ")" << std::endl;
+	std::cout << std::fixed << std::setprecision(3) << "  glTexImage2D in one frame: " << directMs << " ms" << std::endl;
+	std::cout << "  streamed over " << frames << " frames: worst " << worstFrameMs << " ms, " << totalMs << " ms in total, "
+		<< stats.deferred << " frames over budget, " << stats.ringFull << " with the ring full"
+		<< (mismatches ? "  MISMATCH in read-back textures" : "") << std::endl;
+}
+
+// Largest difference between two levels of the same chain, in units of the last place of the type.
+static double maxMipDifference(const MipLevel& a, const MipLevel& b, int channels, MipPixelType type) {
+	size_t count = (size_t)a.width * a.height * channels;
+	double difference = 0.0;
+	for (size_t i = 0; i < count; i++) {
+		if (type == MIP_PIXEL_UNORM8) {
+			difference = std::max(difference, (double)std::abs(a.pixels[i] - b.pixels[i]));
+		}
+		else if (type == MIP_PIXEL_UNORM16) {
+			difference = std::max(difference, (double)std::abs(((unsigned short*)a.pixels)[i] - ((unsigned short*)b.pixels)[i]));
+		}
+		else {
+			float x = ((float*)a.pixels)[i], y = ((float*)b.pixels)[i];
+			difference = std::max(difference, (double)(std::fabs(x - y) / std::max(std::fabs(x), 1e-6f) / FLT_EPSILON));
+		}
+	}
+	return difference;
+}
+
+void runMipGenerationBenchmark() {
+	const int size = 2048;
+	const int runCount = 3;
+	const double megapixels = (double)size * size / 1e6;
+
+	// noise over smooth gradients, with an alpha channel that is half cut out
+	std::vector<unsigned char> unorm8((size_t)size * size * 4);
+	std::vector<unsigned short> unorm16(unorm8.size());
+	std::vector<float> floats(unorm8.size());
+	std::mt19937 random(11);
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			size_t i = ((size_t)y * size + x) * 4;
+			unorm8[i] = (unsigned char)(x * 255 / size);
+			unorm8[i + 1] = (unsigned char)(y * 255 / size);
+			unorm8[i + 2] = (unsigned char)(random() & 255);
+			unorm8[i + 3] = ((x / 16 + y / 16) & 1) ? 255 : (unsigned char)(random() & 127);
+		}
+	}
+	for (size_t i = 0; i < unorm8.size(); i++) {
+		unorm16[i] = (unsigned short)(unorm8[i] * 257);
+		floats[i] = unorm8[i] / 255.0f * 4.0f;
+	}
+
+	struct Source {
+		const char* name;
+		const void* pixels;
+		MipPixelType type;
+		bool srgb;
+	};
+	const Source sources[] = {
+		{ "RGBA8 sRGB", unorm8.data(), MIP_PIXEL_UNORM8, true },
+		{ "RGBA16", unorm16.data(), MIP_PIXEL_UNORM16, false },
+		{ "RGBA32F", floats.data(), MIP_PIXEL_FLOAT, false },
+	};
+	const char* filterNames[] = { "box", "kaiser", "lanczos" };
+
+	auto generate = [](const Source& source, MipFilter filter, bool simd, double& bestMs) {
+		MipSettings settings;
+		settings.filter = filter;
+		settings.srgb = source.srgb;
+		settings.simd = simd;
+		std::vector<MipLevel> levels;
+		bestMs = 1e9;
+		for (int run = 0; run < runCount; run++) {
+			freeMips(levels);
+			auto start = std::chrono::steady_clock::now();
+			levels = generateMips(source.pixels, size, size, 4, source.type, settings);
+			bestMs = std::min(bestMs, elapsedMs(start));
+		}
+		return levels;
+	};
+
+#if defined(__AVX__)
+	const char* simdName = "AVX";
+#else
+	const char* simdName = "SSE2";
+#endif
+	std::cout << "BENCHMARK::MIP_GENERATION (" << size << "x" << size << " source, full chain, one thread, " << simdName << ")" << std::endl;
+	std::cout << std::setw(12) << "format" << std::setw(9) << "filter" << std::setw(12) << "scalar MP/s" << std::setw(12) << "SIMD MP/s"
+		<< std::setw(10) << "speedup" << std::setw(10) << "max diff" << std::endl;
+	for (const Source& source : sources) {
+		for (int filter = MIP_FILTER_BOX; filter <= MIP_FILTER_LANCZOS; filter++) {
+			double scalarMs, simdMs;
+			std::vector<MipLevel> scalar = generate(source, (MipFilter)filter, false, scalarMs);
+			std::vector<MipLevel> simd = generate(source, (MipFilter)filter, true, simdMs);
+			double difference = 0.0;
+			for (size_t level = 0; level < scalar.size(); level++) {
+				difference = std::max(difference, maxMipDifference(scalar[level], simd[level], 4, source.type));
+			}
+			// the kernels add in the same order, but the compiler may fuse the scalar multiply-adds
+			double tolerance = source.type == MIP_PIXEL_FLOAT ? 64.0 : 1.0;
+			std::cout << std::setw(12) << source.name << std::setw(9) << filterNames[filter] << std::fixed << std::setprecision(1)
+				<< std::setw(12) << megapixels * 1000.0 / scalarMs << std::setw(12) << megapixels * 1000.0 / simdMs
+				<< std::setw(10) << scalarMs / simdMs << std::setw(10) << difference
+				<< (difference <= tolerance ? "" : "  MISMATCH against the scalar kernels") << std::endl;
+			freeMips(scalar);
+			freeMips(simd);
+		}
+	}
+
+	// what the workers do while loading: independent images, one chain per thread
+	unsigned int coreCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < coreCount; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(coreCount);
+	const int imageCount = (int)coreCount * 2;
+	std::cout << "  " << imageCount << " RGBA8 sRGB images, kaiser:" << std::endl;
+	for (unsigned int threads : threadCounts) {
+		std::atomic<int> next(0);
+		auto work = [&]() {
+			MipSettings settings;
+			settings.filter = MIP_FILTER_KAISER;
+			settings.srgb = true;
+			while (next++ < imageCount) {
+				std::vector<MipLevel> levels = generateMips(unorm8.data(), size, size, 4, MIP_PIXEL_UNORM8, settings);
+				freeMips(levels);
+			}
+		};
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> workers;
+		for (unsigned int i = 0; i < threads; i++) {
+			workers.emplace_back(work);
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		double totalMs = elapsedMs(start);
+		std::cout << std::setw(6) << threads << " thread(s): " << std::setprecision(1) << imageCount * megapixels * 1000.0 / totalMs << " MP/s" << std::endl;
+	}
+
+	// the driver's box filter for comparison; it can only run on the GL thread
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, unorm8.data());
+	glFinish();
+	double driverMs = 1e9;
+	for (int run = 0; run < runCount; run++) {
+		auto start = std::chrono::steady_clock::now();
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glFinish();
+		driverMs = std::min(driverMs, elapsedMs(start));
+	}
+	glDeleteTextures(1, &texture);
+	std::cout << "  glGenerateMipmap on GL_SRGB8_ALPHA8: " << megapixels * 1000.0 / driverMs << " MP/s" << std::endl;
+}
+
+void runJpegDecodingBenchmark() {
+	const char* paths[] = { "Textures/container.jpg", "Textures/wall.jpg" };
+	const int fileCount = 2;
+	const int decodeCount = 16;
+	const int runCount = 3;
+	const char* levelNames[] = { "generic C", "SSE2/NEON", "AVX2" };
+
+	MappedFile files[fileCount];
+	for (int i = 0; i < fileCount; i++) {
+		if (!files[i].open(paths[i])) {
+			std::cout << "ERROR::BENCHMARK::JPEG_DECODING::FILE_NOT_FOUND " << paths[i] << std::endl;
+			return;
+		}
+	}
+
+	// best of runCount passes over the corpus; the checksum chains every decoded image in order
+	auto decodeCorpus = [&](int channels, unsigned long long& checksum) {
+		double bestMs = 1e9;
+		size_t pixelCount = 0;
+		for (int run = 0; run < runCount; run++) {
+			checksum = FNV_OFFSET_BASIS;
+			pixelCount = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (int decode = 0; decode < decodeCount; decode++) {
+				for (const MappedFile& file : files) {
+					int width, height, fileChannels;
+					unsigned char* pixels = stbi_load_from_memory((const stbi_uc*)file.getData(), (int)file.getSize(), &width, &height, &fileChannels, channels);
+					if (!pixels) {
+						continue;
+					}
+					if (decode == 0) {
+						checksum = hashBytes(checksum, pixels, (size_t)width * height * channels);
+					}
+					pixelCount += (size_t)width * height;
+					stbi_image_free(pixels);
+				}
+			}
+			bestMs = std::min(bestMs, elapsedMs(start));
+		}
+		return pixelCount / 1e6 * 1000.0 / bestMs;
+	};
+
+	std::cout << "BENCHMARK::JPEG_DECODING (" << fileCount << " files, " << decodeCount << " decodes each, from memory, one thread)" << std::endl;
+	std::cout << std::setw(12) << "kernels" << std::setw(12) << "RGB MP/s" << std::setw(10) << "speedup" << std::setw(12) << "RGBA MP/s"
+		<< std::setw(10) << "speedup" << std::endl;
+	double baseline[2] = {};
+	unsigned long long expected[2] = {};
+	for (int level = 0; level <= 2; level++) {
+		if (stbi_set_jpeg_simd_level(level) < level) {
+			std::cout << std::setw(12) << levelNames[level] << "  not supported by this CPU or build" << std::endl;
+			continue;
+		}
+		std::cout << std::setw(12) << levelNames[level];
+		bool mismatch = false;
+		for (int layout = 0; layout < 2; layout++) {
+			unsigned long long checksum;
+			double megapixelsPerSecond = decodeCorpus(layout == 0 ? 3 : 4, checksum);
+			if (level == 0) {
+				baseline[layout] = megapixelsPerSecond;
+				expected[layout] = checksum;
+			}
+			mismatch |= checksum != expected[layout];
+			std::cout << std::fixed << std::setprecision(1) << std::setw(12) << megapixelsPerSecond << std::setprecision(2) << std::setw(10)
+				<< megapixelsPerSecond / baseline[layout];
+		}
+		std::cout << (mismatch ? "  MISMATCH against the generic kernels" : "") << std::endl;
+	}
+	stbi_set_jpeg_simd_level(2);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "InstanceBuffer.h"
+#include "RenderQueue.h"
+#include "StateCache.h"
+#include "MeshBatch.h"
+#include "FrustumCuller.h"
+#include "GpuCuller.h"
+#include "Shaders.h"
+#include "TextureLoader.h"
+#include "TextureUploader.h"
+
+// Micro-benchmarks for the render paths. They need a current GL context and are run from main()
+// when the project is built with RUN_BENCHMARKS defined.
+
+// Compares CPU submit time of the per-cube uniform + glDrawElements loop against a single
+// glDrawElementsInstanced call, for instance counts from 10 up to 1M. cubeVAO holds the indexed
+// 36-index cube; instanceBuffer must already be attached to it and its contents are overwritten.
+void runInstancingBenchmark(unsigned int cubeVAO, InstanceBuffer& instanceBuffer, unsigned int perCubeProgram, unsigned int instancedProgram, GLStateCache& stateCache);
+
+
+// Records 500k draw items spread over several materials at random depths, then radix-sorts and
+// submits them through a RenderQueue for a number of frames. Reports the worst sort + submit against
+// RENDER_QUEUE_BUDGET_MS, and the instance matrix upload, which the budget doesn't cover, separately.
+void runRenderQueueBenchmark(unsigned int cubeVAO, InstanceBuffer& instanceBuffer, unsigned int instancedProgram, unsigned int texture1, unsigned int texture2, GLStateCache& stateCache);
+
+// Draws 1000 distinct meshes through a MeshBatch with each available multi-draw path and reports
+// CPU submit time and the number of GL calls each path needs.
+void runMultiDrawBenchmark(unsigned int instancedProgram, GLStateCache& stateCache);
+
+// Culls 1M random bounding spheres against a camera frustum on one thread and on all cores,
+// checks both against a scalar reference and reports the time per cull.
+void runFrustumCullingBenchmark();
+
+// Culls the same 1M spheres with the compute shader, checks the read-back result against FrustumCuller
+// and reports CPU submit time and the time until the GPU has finished. Skipped without GL 4.3.
+void runGpuCullingBenchmark(ShaderLoader& shaderLoader);
+
+
+// Loads the images in Textures/ 32 times each, first one after the other with stbi_load on this thread
+// like the renderer used to, then through a TextureLoader with 1 worker up to one per core. Every
+// image is uploaded to a scratch texture, so the times are end to end. Reports the time, megapixels
+// per second and the speedup over serial loading for each worker count.
+void runTextureLoadingBenchmark();
+
+// Uploads 96 textures made from the images in Textures/ in one go with glTexImage2D, then streams the
+// same set through a TextureUploader with a small ring and budget, one update per frame. Reports the
+// worst frame of each and how many frames streaming took, and reads every texture back to check it.
+void runTextureStreamingBenchmark();
+
+// Builds full mip chains of a 2048x2048 image in 8-bit sRGB, 16-bit and float, with each filter, once
+// with the scalar kernels and once with the SIMD ones, checks they agree and reports megapixels per
+// second of source image. Then runs the same on 1 up to one thread per core, the way the TextureLoader
+// workers use it, and times glGenerateMipmap on the same image for comparison.
+void runMipGenerationBenchmark();
+
+// Decodes the JPEGs in Textures/ from memory with stb_image's generic C kernels, then the SSE2 (or
+// NEON) ones and the AVX2 ones where the CPU has them, to 3 and to 4 channels, the two layouts the
+// loaders ask for. Checks every level decodes to the same bytes and reports megapixels per second and
+// the speedup over the generic kernels.
+void runJpegDecodingBenchmark();
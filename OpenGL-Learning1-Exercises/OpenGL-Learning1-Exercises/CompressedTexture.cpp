@@ -0,0 +1,93 @@
+#include "CompressedTexture.h"
+#include <chrono>
+#include <iostream>
+
+#include "GLExtensions.h"
+#include "MappedFile.h"
+#include "TextureContainer.h"
+#include "Timing.h"
+
+// GL format for a container format, 0 when the context can't sample it.
+static GLenum glFormatFor(unsigned int vkFormat) {
+	switch (vkFormat) {
+	case CONTAINER_FORMAT_BC1_RGB_UNORM:
+		return glExtensions.hasTextureCompressionS3TC ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+	case CONTAINER_FORMAT_BC1_RGB_SRGB:
+		return glExtensions.hasTextureCompressionS3TCsRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : 0;
+	case CONTAINER_FORMAT_BC3_UNORM:
+		return glExtensions.hasTextureCompressionS3TC ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+	case CONTAINER_FORMAT_BC3_SRGB:
+		return glExtensions.hasTextureCompressionS3TCsRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : 0;
+	case CONTAINER_FORMAT_BC4_UNORM:
+		return GL_COMPRESSED_RED_RGTC1;
+	case CONTAINER_FORMAT_BC5_UNORM:
+		return GL_COMPRESSED_RG_RGTC2;
+	default:
+		return 0;
+	}
+}
+
+unsigned int loadCompressedTexture(const char* path, GLStateCache& stateCache, CompressedTextureInfo* info) {
+	auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.open(path)) {
+		return 0;
+	}
+	const TextureContainerHeader* header = (const TextureContainerHeader*)file.getData();
+	if (file.getSize() < sizeof(TextureContainerHeader) || !isContainerIdentifier(header->identifier)) {
+		std::cout << "ERROR::COMPRESSED_TEXTURE::NOT_A_CONTAINER " << path << std::endl;
+		return 0;
+	}
+	unsigned int levelCount = header->levelCount;
+	if (header->pixelWidth == 0 || header->pixelHeight == 0 || header->pixelDepth != 0 || header->layerCount != 0 || header->faceCount != 1
+		|| header->supercompressionScheme != 0 || levelCount == 0 || levelCount > TEXTURE_CONTAINER_MAX_LEVELS
+		|| file.getSize() < sizeof(TextureContainerHeader) + levelCount * sizeof(TextureContainerLevel)) {
+		std::cout << "ERROR::COMPRESSED_TEXTURE::UNSUPPORTED_LAYOUT " << path << std::endl;
+		return 0;
+	}
+	GLenum internalFormat = glFormatFor(header->vkFormat);
+	if (internalFormat == 0) {
+		std::cout << "ERROR::COMPRESSED_TEXTURE::UNSUPPORTED_FORMAT " << path << " vkFormat " << header->vkFormat << std::endl;
+		return 0;
+	}
+
+	// check every level before creating anything, so a truncated file doesn't leave half a texture
+	const TextureContainerLevel* levels = (const TextureContainerLevel*)(file.getData() + sizeof(TextureContainerHeader));
+	size_t totalBytes = 0;
+	for (unsigned int level = 0; level < levelCount; level++) {
+		unsigned int width = header->pixelWidth >> level ? header->pixelWidth >> level : 1;
+		unsigned int height = header->pixelHeight >> level ? header->pixelHeight >> level : 1;
+		if (levels[level].byteLength != containerLevelBytes(header->vkFormat, width, height)
+			|| levels[level].byteOffset > file.getSize() || levels[level].byteLength > file.getSize() - levels[level].byteOffset) {
+			std::cout << "ERROR::COMPRESSED_TEXTURE::BAD_LEVEL " << path << " level " << level << std::endl;
+			return 0;
+		}
+		totalBytes += (size_t)levels[level].byteLength;
+	}
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	stateCache.bindTexture(0, GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// the cooker may stop before 1x1, and the texture is only complete with the levels it has
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	for (unsigned int level = 0; level < levelCount; level++) {
+		unsigned int width = header->pixelWidth >> level ? header->pixelWidth >> level : 1;
+		unsigned int height = header->pixelHeight >> level ? header->pixelHeight >> level : 1;
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, (GLsizei)levels[level].byteLength,
+			file.getData() + levels[level].byteOffset);
+	}
+
+	if (info) {
+		info->internalFormat = internalFormat;
+		info->width = header->pixelWidth;
+		info->height = header->pixelHeight;
+		info->levels = levelCount;
+		info->bytes = totalBytes;
+		info->loadMs = elapsedMs(start);
+	}
+	return texture;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+#include "StateCache.h"
+
+struct CompressedTextureInfo {
+	GLenum internalFormat;
+	int width;
+	int height;
+	unsigned int levels;
+	size_t bytes; // of all levels, as they sit in GPU memory
+	double loadMs;
+};
+
+// Creates a 2D texture from a file written by Tools/CookTextures (see TextureContainer.h). Every level
+// is already block compressed, so the upload is a copy of the mapped file: no decoding, no mipmap
+// generation and a quarter to an eighth of the memory of the RGBA8 texture. Returns 0 without a message
+// when the file doesn't exist, so callers can fall back to the source image, and 0 with an error when it
+// is malformed or its format isn't supported by the context.
+// The texture is left bound to GL_TEXTURE_2D on unit 0, bound through stateCache like createTexture2D.
+unsigned int loadCompressedTexture(const char* path, GLStateCache& stateCache, CompressedTextureInfo* info = nullptr);
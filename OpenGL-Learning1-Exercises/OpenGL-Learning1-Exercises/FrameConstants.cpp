@@ -0,0 +1,71 @@
+#include "FrameConstants.h"
+
+// fills the block in std140 order
+static FrameConstants makeFrameConstants(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time) {
+	FrameConstants constants;
+	constants.view = view;
+	constants.projection = projection;
+	constants.viewProjection = projection * view;
+	constants.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+	constants.time = time;
+	constants.padding[0] = constants.padding[1] = constants.padding[2] = 0.0f;
+	return constants;
+}
+
+void FrameConstantsBuffer::bindBuffer(unsigned int buffer) {
+	if (stateCache) {
+		stateCache->bindBuffer(GL_UNIFORM_BUFFER, buffer);
+	}
+	else {
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	}
+}
+
+// binds size bytes of buffer from offset to FRAME_CONSTANTS_BINDING, which also makes buffer the generic binding
+void FrameConstantsBuffer::bindBlock(unsigned int buffer, size_t offset, size_t size) {
+	if (stateCache) {
+		stateCache->bindBufferRange(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, buffer, offset, size);
+	}
+	else {
+		glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, buffer, offset, size);
+	}
+}
+
+void FrameConstantsBuffer::create() {
+	glGenBuffers(1, &ubo);
+	bindBuffer(ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL, GL_DYNAMIC_DRAW);
+	bindBuffer(0);
+	bindBlock(ubo, 0, sizeof(FrameConstants));
+
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformOffsetAlignment);
+}
+
+void FrameConstantsBuffer::update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time) {
+	FrameConstants constants = makeFrameConstants(view, projection, cameraPosition, time);
+
+	bindBuffer(ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &constants);
+	bindBuffer(0);
+	bindBlock(ubo, 0, sizeof(FrameConstants));
+}
+
+void FrameConstantsBuffer::update(StreamBuffer& streamBuffer, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time) {
+	size_t gpuOffset;
+	void* destination = streamBuffer.map(sizeof(FrameConstants), uniformOffsetAlignment, gpuOffset);
+	if (!destination) {
+		update(view, projection, cameraPosition, time);
+		return;
+	}
+	*(FrameConstants*)destination = makeFrameConstants(view, projection, cameraPosition, time);
+	streamBuffer.unmap();
+	bindBlock(streamBuffer.getBuffer(), gpuOffset, sizeof(FrameConstants));
+}
+
+void FrameConstantsBuffer::destroy() {
+	if (stateCache) {
+		stateCache->forgetBuffer(ubo);
+	}
+	glDeleteBuffers(1, &ubo);
+	ubo = 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "StateCache.h"
+#include "StreamBuffer.h"
+
+// Uniform buffer binding point reserved for the per-frame constants. ShaderLoader binds the
+// FrameConstants block of every program it links to this point.
+const unsigned int FRAME_CONSTANTS_BINDING = 0;
+const char* const FRAME_CONSTANTS_BLOCK_NAME = "FrameConstants";
+
+// Mirrors the std140 "FrameConstants" uniform block declared in the shaders:
+// layout(std140) uniform FrameConstants {
+//     mat4 view; mat4 projection; mat4 viewProjection; vec4 cameraPosition; float time;
+// };
+// std140 rounds vec3 up to vec4 and the block size up to a multiple of 16 bytes, hence the padding.
+struct FrameConstants {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec4 cameraPosition;
+	float time;
+	float padding[3];
+};
+static_assert(sizeof(FrameConstants) == 224, "FrameConstants must match the std140 block layout");
+
+// Uniform buffer holding FrameConstants. It is written once per frame and shared by every program,
+// so the camera matrices no longer have to be uploaded to each program separately.
+class FrameConstantsBuffer {
+private:
+	unsigned int ubo = 0;
+	int uniformOffsetAlignment = 256;
+	GLStateCache* stateCache = nullptr;
+
+	void bindBuffer(unsigned int buffer);
+	void bindBlock(unsigned int buffer, size_t offset, size_t size);
+
+public:
+	void create();
+	void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time);
+	// Same, but the block is written into the stream buffer and bound from there with glBindBufferRange.
+	void update(StreamBuffer& streamBuffer, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time);
+	void destroy();
+
+	// When set, the uniform buffer bindings go through the state cache so it stays in sync.
+	void setStateCache(GLStateCache* cache) { stateCache = cache; }
+};
@@ -0,0 +1,174 @@
+#include "FrustumCuller.h"
+#include <chrono>
+#include <thread>
+
+#include "Timing.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection) {
+	// rows of the matrix, glm stores columns
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++) {
+		row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	Frustum frustum;
+	frustum.planes[0] = row[3] + row[0];
+	frustum.planes[1] = row[3] - row[0];
+	frustum.planes[2] = row[3] + row[1];
+	frustum.planes[3] = row[3] - row[1];
+	frustum.planes[4] = row[3] + row[2];
+	frustum.planes[5] = row[3] - row[2];
+	for (int i = 0; i < 6; i++) {
+		glm::vec4& plane = frustum.planes[i];
+		plane = plane / glm::length(glm::vec3(plane.x, plane.y, plane.z));
+	}
+	return frustum;
+}
+
+void BoundingSpheres::add(const glm::vec3& center, float sphereRadius) {
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	radius.push_back(sphereRadius);
+}
+
+void BoundingSpheres::clear() {
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radius.clear();
+}
+
+void BoundingSpheres::reserve(size_t count) {
+	centerX.reserve(count);
+	centerY.reserve(count);
+	centerZ.reserve(count);
+	radius.reserve(count);
+}
+
+static bool sphereVisible(const Frustum& frustum, float x, float y, float z, float r) {
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < -r) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// culls spheres [begin, end) and appends the visible indices to out
+static void cullRange(const Frustum& frustum, const BoundingSpheres& spheres, size_t begin, size_t end, std::vector<unsigned int>& out) {
+	const float* xs = spheres.centerX.data();
+	const float* ys = spheres.centerY.data();
+	const float* zs = spheres.centerZ.data();
+	const float* rs = spheres.radius.data();
+	size_t i = begin;
+
+#if defined(__AVX__)
+	const size_t width = 8;
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+	for (; i + width <= end; i += width) {
+		__m256 x = _mm256_loadu_ps(xs + i);
+		__m256 y = _mm256_loadu_ps(ys + i);
+		__m256 z = _mm256_loadu_ps(zs + i);
+		__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(rs + i));
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+				_mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+		int mask = _mm256_movemask_ps(inside);
+#else
+	const size_t width = 4;
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+	for (; i + width <= end; i += width) {
+		__m128 x = _mm_loadu_ps(xs + i);
+		__m128 y = _mm_loadu_ps(ys + i);
+		__m128 z = _mm_loadu_ps(zs + i);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(rs + i));
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+		int mask = _mm_movemask_ps(inside);
+#endif
+		if (mask) {
+			for (size_t lane = 0; lane < width; lane++) {
+				if (mask & (1 << lane)) {
+					out.push_back((unsigned int)(i + lane));
+				}
+			}
+		}
+	}
+
+	for (; i < end; i++) {
+		if (sphereVisible(frustum, xs[i], ys[i], zs[i], rs[i])) {
+			out.push_back((unsigned int)i);
+		}
+	}
+}
+
+FrustumCuller::FrustumCuller() {
+	threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0) {
+		threadCount = 1;
+	}
+}
+
+const CullStats& FrustumCuller::cull(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<unsigned int>& visible) {
+	auto start = std::chrono::steady_clock::now();
+	size_t count = spheres.size();
+	visible.clear();
+
+	if (count < PARALLEL_THRESHOLD || threadCount == 1) {
+		cullRange(frustum, spheres, 0, count, visible);
+	}
+	else {
+		// contiguous chunks keep each thread's reads sequential and the merged result sorted
+		threadResults.resize(threadCount);
+		size_t chunk = (count + threadCount - 1) / threadCount;
+		chunk = (chunk + 7) & ~(size_t)7;
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < threadCount; t++) {
+			size_t begin = t * chunk;
+			size_t end = begin + chunk < count ? begin + chunk : count;
+			threadResults[t].clear();
+			if (begin < end) {
+				workers.emplace_back(cullRange, std::cref(frustum), std::cref(spheres), begin, end, std::ref(threadResults[t]));
+			}
+		}
+		cullRange(frustum, spheres, 0, chunk < count ? chunk : count, visible);
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		for (unsigned int t = 1; t < threadCount; t++) {
+			visible.insert(visible.end(), threadResults[t].begin(), threadResults[t].end());
+		}
+	}
+
+	lastStats.visible = (unsigned int)visible.size();
+	lastStats.culled = (unsigned int)(count - visible.size());
+	lastStats.milliseconds = elapsedMs(start);
+	return lastStats;
+}
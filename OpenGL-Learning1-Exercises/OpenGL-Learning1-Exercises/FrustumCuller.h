@@ -0,0 +1,49 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+// Six normalized planes (left, right, bottom, top, near, far) as ax + by + cz + d >= 0 inside.
+struct Frustum {
+	glm::vec4 planes[6];
+
+	// Extracts the planes from a projection * view matrix (Gribb/Hartmann), so the result is in world space.
+	static Frustum fromViewProjection(const glm::mat4& viewProjection);
+};
+
+// Bounding spheres in structure-of-arrays form so four or eight of them fill one SIMD register.
+struct BoundingSpheres {
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	void add(const glm::vec3& center, float sphereRadius);
+	void clear();
+	void reserve(size_t count);
+	size_t size() const { return radius.size(); }
+};
+
+struct CullStats {
+	unsigned int visible = 0;
+	unsigned int culled = 0;
+	double milliseconds = 0.0;
+};
+
+// Tests bounding spheres against a frustum, eight at a time with AVX or four at a time with SSE.
+// Above PARALLEL_THRESHOLD spheres the range is split across worker threads.
+class FrustumCuller {
+private:
+	unsigned int threadCount;
+	std::vector<std::vector<unsigned int>> threadResults;
+	CullStats lastStats;
+
+public:
+	static const size_t PARALLEL_THRESHOLD = 65536;
+
+	FrustumCuller();
+	void setThreadCount(unsigned int count) { threadCount = count ? count : 1; }
+
+	// Fills visible with the indices of the spheres that intersect the frustum, in ascending order.
+	const CullStats& cull(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<unsigned int>& visible);
+	const CullStats& getLastStats() const { return lastStats; }
+};
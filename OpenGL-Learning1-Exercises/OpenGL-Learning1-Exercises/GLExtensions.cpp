@@ -0,0 +1,78 @@
+#include "GLExtensions.h"
+#include <iostream>
+
+GLExtensions glExtensions;
+
+bool isGLVersionAtLeast(int major, int minor) {
+	return glExtensions.majorVersion > major || (glExtensions.majorVersion == major && glExtensions.minorVersion >= minor);
+}
+
+// Resolves an entry point that is either core in the given version or provided by the extension.
+template <typename Proc>
+static bool loadOptional(Proc& proc, const char* name, int coreMajor, int coreMinor, const char* extension) {
+	proc = nullptr;
+	if (isGLVersionAtLeast(coreMajor, coreMinor) || glfwExtensionSupported(extension)) {
+		proc = (Proc)glfwGetProcAddress(name);
+	}
+	return proc != nullptr;
+}
+
+// Resolves an entry point that only exists as an extension.
+template <typename Proc>
+static bool loadOptional(Proc& proc, const char* name, const char* extension) {
+	proc = nullptr;
+	if (glfwExtensionSupported(extension)) {
+		proc = (Proc)glfwGetProcAddress(name);
+	}
+	return proc != nullptr;
+}
+
+void loadGLExtensions() {
+	glGetIntegerv(GL_MAJOR_VERSION, &glExtensions.majorVersion);
+	glGetIntegerv(GL_MINOR_VERSION, &glExtensions.minorVersion);
+
+	glExtensions.hasBufferStorage = loadOptional(glExtensions.bufferStorage, "glBufferStorage", 4, 4, "GL_ARB_buffer_storage");
+	glExtensions.hasBaseInstance = loadOptional(glExtensions.drawElementsInstancedBaseVertexBaseInstance, "glDrawElementsInstancedBaseVertexBaseInstance", 4, 2, "GL_ARB_base_instance");
+	glExtensions.hasMultiDrawIndirect = loadOptional(glExtensions.multiDrawElementsIndirect, "glMultiDrawElementsIndirect", 4, 3, "GL_ARB_multi_draw_indirect");
+
+	glExtensions.hasProgramBinary = loadOptional(glExtensions.getProgramBinary, "glGetProgramBinary", 4, 1, "GL_ARB_get_program_binary")
+		&& loadOptional(glExtensions.programBinary, "glProgramBinary", 4, 1, "GL_ARB_get_program_binary")
+		&& loadOptional(glExtensions.programParameteri, "glProgramParameteri", 4, 1, "GL_ARB_get_program_binary");
+	if (glExtensions.hasProgramBinary) {
+		// drivers are allowed to support the entry points with zero formats, which makes them useless
+		int formatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		glExtensions.hasProgramBinary = formatCount > 0;
+	}
+
+	glExtensions.hasParallelShaderCompile = loadOptional(glExtensions.maxShaderCompilerThreads, "glMaxShaderCompilerThreadsKHR", "GL_KHR_parallel_shader_compile")
+		|| loadOptional(glExtensions.maxShaderCompilerThreads, "glMaxShaderCompilerThreadsARB", "GL_ARB_parallel_shader_compile");
+	if (glExtensions.hasParallelShaderCompile) {
+		// let the driver pick how many compiler threads to use
+		glExtensions.maxShaderCompilerThreads(0xFFFFFFFFu);
+	}
+
+	// the compute shaders are GLSL 4.30 and use storage buffers, so the ARB extensions alone on an
+	// older context aren't enough
+	glExtensions.hasComputeShader = isGLVersionAtLeast(4, 3)
+		&& loadOptional(glExtensions.dispatchCompute, "glDispatchCompute", 4, 3, "GL_ARB_compute_shader")
+		&& loadOptional(glExtensions.memoryBarrier, "glMemoryBarrier", 4, 2, "GL_ARB_shader_image_load_store");
+
+	glExtensions.hasDebugOutput = loadOptional(glExtensions.debugMessageCallback, "glDebugMessageCallback", 4, 3, "GL_KHR_debug")
+		&& loadOptional(glExtensions.debugMessageControl, "glDebugMessageControl", 4, 3, "GL_KHR_debug");
+
+	// no entry points, glCompressedTexImage2D is core; only the formats are optional
+	glExtensions.hasTextureCompressionS3TC = glfwExtensionSupported("GL_EXT_texture_compression_s3tc") != 0;
+	glExtensions.hasTextureCompressionS3TCsRGB = glExtensions.hasTextureCompressionS3TC
+		&& (glfwExtensionSupported("GL_EXT_texture_sRGB") || glfwExtensionSupported("GL_EXT_texture_compression_s3tc_srgb"));
+
+	std::cout << "OpenGL " << glExtensions.majorVersion << "." << glExtensions.minorVersion
+		<< (glExtensions.hasBufferStorage ? ", buffer storage" : "")
+		<< (glExtensions.hasBaseInstance ? ", base instance" : "")
+		<< (glExtensions.hasMultiDrawIndirect ? ", multi-draw indirect" : "")
+		<< (glExtensions.hasProgramBinary ? ", program binaries" : "")
+		<< (glExtensions.hasParallelShaderCompile ? ", parallel shader compile" : "")
+		<< (glExtensions.hasComputeShader ? ", compute shaders" : "")
+		<< (glExtensions.hasDebugOutput ? ", debug output" : "")
+		<< (glExtensions.hasTextureCompressionS3TC ? (glExtensions.hasTextureCompressionS3TCsRGB ? ", S3TC (sRGB)" : ", S3TC") : "") << std::endl;
+}
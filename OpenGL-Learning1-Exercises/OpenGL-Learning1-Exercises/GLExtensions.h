@@ -0,0 +1,134 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// glad is generated for core 3.3 without extensions, so entry points and tokens from newer versions
+// are declared here and resolved at runtime through GLFW. Everything in this file is optional: check
+// the matching has* flag before calling any of the function pointers.
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+#ifndef GL_DEBUG_OUTPUT_SYNCHRONOUS
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#endif
+#ifndef GL_DEBUG_TYPE_PERFORMANCE
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RED_RGTC1
+#define GL_COMPRESSED_RED_RGTC1 0x8DBB
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEEXTPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEEXTPROC)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLint basevertex, GLuint baseinstance);
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYEXTPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYEXTPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIEXTPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSEXTPROC)(GLuint count);
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEEXTPROC)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+typedef void (APIENTRYP PFNGLMEMORYBARRIEREXTPROC)(GLbitfield barriers);
+typedef void (APIENTRY* GLDEBUGPROCEXT)(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
+typedef void (APIENTRYP PFNGLDEBUGMESSAGECALLBACKEXTPROC)(GLDEBUGPROCEXT callback, const void* userParam);
+typedef void (APIENTRYP PFNGLDEBUGMESSAGECONTROLEXTPROC)(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled);
+
+struct GLExtensions {
+	int majorVersion = 3;
+	int minorVersion = 3;
+
+	bool hasBufferStorage = false; // GL 4.4 / ARB_buffer_storage
+	PFNGLBUFFERSTORAGEEXTPROC bufferStorage = nullptr;
+
+	bool hasBaseInstance = false; // GL 4.2 / ARB_base_instance
+	PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEEXTPROC drawElementsInstancedBaseVertexBaseInstance = nullptr;
+
+	bool hasMultiDrawIndirect = false; // GL 4.3 / ARB_multi_draw_indirect
+	PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC multiDrawElementsIndirect = nullptr;
+
+	// GL 4.1 / ARB_get_program_binary, and the driver exposes at least one binary format
+	bool hasProgramBinary = false;
+	PFNGLGETPROGRAMBINARYEXTPROC getProgramBinary = nullptr;
+	PFNGLPROGRAMBINARYEXTPROC programBinary = nullptr;
+	PFNGLPROGRAMPARAMETERIEXTPROC programParameteri = nullptr;
+
+	// KHR_parallel_shader_compile (or the ARB variant): GL_COMPLETION_STATUS_KHR can be polled
+	// without waiting for the compile or link to finish
+	bool hasParallelShaderCompile = false;
+	PFNGLMAXSHADERCOMPILERTHREADSEXTPROC maxShaderCompilerThreads = nullptr;
+
+	// GL 4.3: compute shaders and shader storage buffers
+	bool hasComputeShader = false;
+	PFNGLDISPATCHCOMPUTEEXTPROC dispatchCompute = nullptr;
+	PFNGLMEMORYBARRIEREXTPROC memoryBarrier = nullptr;
+
+	// GL 4.3 / KHR_debug: driver messages delivered to a callback. Many drivers only send their
+	// performance warnings to debug contexts
+	bool hasDebugOutput = false;
+	PFNGLDEBUGMESSAGECALLBACKEXTPROC debugMessageCallback = nullptr;
+	PFNGLDEBUGMESSAGECONTROLEXTPROC debugMessageControl = nullptr;
+
+	// EXT_texture_compression_s3tc: BC1 and BC3 uploads. BC4 and BC5 (RGTC) are core since 3.0
+	bool hasTextureCompressionS3TC = false;
+	// EXT_texture_sRGB or EXT_texture_compression_s3tc_srgb: the sRGB variants of BC1 and BC3
+	bool hasTextureCompressionS3TCsRGB = false;
+};
+
+extern GLExtensions glExtensions;
+
+// Must be called once the context is current and glad is loaded.
+void loadGLExtensions();
+bool isGLVersionAtLeast(int major, int minor);
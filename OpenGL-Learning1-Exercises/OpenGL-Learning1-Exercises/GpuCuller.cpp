@@ -0,0 +1,138 @@
+#include "GpuCuller.h"
+#include <algorithm>
+#include <chrono>
+
+#include "GLExtensions.h"
+#include "Timing.h"
+
+bool GpuCuller::create(ShaderLoader& loader) {
+	if (!glExtensions.hasComputeShader || !glExtensions.hasMultiDrawIndirect) {
+		return false;
+	}
+	shaderLoader = &loader;
+	program = loader.createComputeProgram("Shaders/Compute/frustumCullComputeShader.comp");
+	// the loader has already reported why; the caller falls back to culling on the CPU
+	int linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		loader.releaseShaderProgram(program);
+		program = 0;
+		return false;
+	}
+
+	unsigned int buffers[5];
+	glGenBuffers(5, buffers);
+	sphereBuffer = buffers[0];
+	modelBuffer = buffers[1];
+	visibleModelBuffer = buffers[2];
+	visibleIndexBuffer = buffers[3];
+	commandBuffer = buffers[4];
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawElementsIndirectCommand), &command, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return true;
+}
+
+void GpuCuller::destroy() {
+	unsigned int buffers[5] = { sphereBuffer, modelBuffer, visibleModelBuffer, visibleIndexBuffer, commandBuffer };
+	glDeleteBuffers(5, buffers);
+	sphereBuffer = modelBuffer = visibleModelBuffer = visibleIndexBuffer = commandBuffer = 0;
+	instanceCount = 0;
+	if (program) {
+		shaderLoader->releaseShaderProgram(program);
+		program = 0;
+	}
+}
+
+void GpuCuller::attach(GLStateCache& stateCache, unsigned int vao, unsigned int firstAttribute) {
+	stateCache.bindVertexArray(vao);
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, visibleModelBuffer);
+	for (unsigned int i = 0; i < 4; i++) {
+		glVertexAttribPointer(firstAttribute + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(firstAttribute + i);
+		glVertexAttribDivisor(firstAttribute + i, 1);
+	}
+	stateCache.bindVertexArray(0);
+}
+
+void GpuCuller::setInstances(const BoundingSpheres& spheres, const glm::mat4* models) {
+	instanceCount = (unsigned int)spheres.size();
+
+	// the shader reads one vec4 per sphere, so the structure-of-arrays layout is interleaved once here
+	std::vector<glm::vec4> packed(instanceCount);
+	for (unsigned int i = 0; i < instanceCount; i++) {
+		packed[i] = glm::vec4(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], spheres.radius[i]);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sphereBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCount * sizeof(glm::vec4), packed.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, modelBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCount * sizeof(glm::mat4), models, GL_STATIC_DRAW);
+
+	// sized for every instance being visible; only ever written by the GPU
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleModelBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCount * sizeof(glm::mat4), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleIndexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCount * sizeof(unsigned int), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCuller::setMesh(unsigned int indexCount, unsigned int firstIndex, int baseVertex) {
+	command.count = indexCount;
+	command.firstIndex = firstIndex;
+	command.baseVertex = baseVertex;
+}
+
+void GpuCuller::cull(const Frustum& frustum) {
+	auto start = std::chrono::steady_clock::now();
+
+	// the shader counts up from zero; the draw that read the previous count is ordered before this update
+	command.instanceCount = 0;
+	command.baseInstance = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DrawElementsIndirectCommand), &command);
+
+	if (instanceCount > 0) {
+		shaderLoader->use(shaderLoader->resolve(program));
+		shaderLoader->setUniform(shaderLoader->getUniformHandle("planes"), frustum.planes, 6);
+		shaderLoader->setUniform(shaderLoader->getUniformHandle("instanceCount"), instanceCount);
+		shaderLoader->flushUniforms();
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sphereBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, modelBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visibleModelBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, visibleIndexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, commandBuffer);
+
+		unsigned int groups = (instanceCount + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE;
+		unsigned int groupsX = std::min(groups, MAX_GROUPS_X);
+		unsigned int groupsY = (groups + groupsX - 1) / groupsX;
+		glExtensions.dispatchCompute(groupsX, groupsY, 1);
+		// the draw reads the command and the compacted matrices the shader just wrote
+		glExtensions.memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	lastSubmitMs = elapsedMs(start);
+}
+
+void GpuCuller::draw(GLenum mode) const {
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glExtensions.multiDrawElementsIndirect(mode, GL_UNSIGNED_INT, 0, 1, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GpuCuller::readVisible(std::vector<unsigned int>& visible) const {
+	glExtensions.memoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	DrawElementsIndirectCommand result = {};
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DrawElementsIndirectCommand), &result);
+
+	// work groups append in whatever order they finish, so the list is sorted to compare it
+	visible.resize(result.instanceCount);
+	if (result.instanceCount > 0) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleIndexBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, result.instanceCount * sizeof(unsigned int), visible.data());
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	std::sort(visible.begin(), visible.end());
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "FrustumCuller.h"
+#include "MeshBatch.h"
+#include "Shaders.h"
+
+// GL 4.3 culling path that keeps all per-instance data on the GPU. Bounding spheres and model matrices
+// are uploaded once; each cull() dispatches Shaders/Compute/frustumCullComputeShader.comp, which
+// tests every sphere against the frustum, compacts the visible instances' matrices into the buffer
+// attached to the draw VAO and counts them into the instanceCount of an indirect draw command with
+// atomics. draw() then reads both from GPU memory, so per frame the CPU only sends six planes.
+class GpuCuller {
+private:
+	ShaderLoader* shaderLoader = nullptr;
+	unsigned int program = 0;
+	unsigned int sphereBuffer = 0;
+	unsigned int modelBuffer = 0;
+	unsigned int visibleModelBuffer = 0;
+	unsigned int visibleIndexBuffer = 0; // only read back for verification
+	unsigned int commandBuffer = 0;
+	unsigned int instanceCount = 0;
+	DrawElementsIndirectCommand command = {};
+	double lastSubmitMs = 0.0;
+
+public:
+	static const unsigned int WORK_GROUP_SIZE = 64; // local_size_x in the compute shader
+	static const unsigned int MAX_GROUPS_X = 65535; // minimum GL_MAX_COMPUTE_WORK_GROUP_COUNT
+
+	// Returns false, and creates nothing, when the context has no compute shaders or the culling
+	// program fails to compile or link.
+	bool create(ShaderLoader& loader);
+	void destroy();
+
+	// Points attributes firstAttribute to firstAttribute + 3 of vao at the compacted model matrices,
+	// one mat4 per instance like InstanceBuffer.
+	void attach(GLStateCache& stateCache, unsigned int vao, unsigned int firstAttribute);
+	void setInstances(const BoundingSpheres& spheres, const glm::mat4* models);
+	// The range of GL_UNSIGNED_INT indices in the draw VAO's element buffer drawn for every instance.
+	void setMesh(unsigned int indexCount, unsigned int firstIndex = 0, int baseVertex = 0);
+
+	void cull(const Frustum& frustum);
+	// The draw VAO has to be bound.
+	void draw(GLenum mode = GL_TRIANGLES) const;
+	// Waits for the last cull and returns the visible instance indices in ascending order, the same
+	// list FrustumCuller produces for the same spheres.
+	void readVisible(std::vector<unsigned int>& visible) const;
+
+	unsigned int getInstanceCount() const { return instanceCount; }
+	double getLastSubmitMs() const { return lastSubmitMs; }
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+// FNV-1a 64. Pass the previous result as hash to chain several pieces of data into one key.
+// Shared by the runtime and Tools/EmbedShaders, whose precomputed hashes have to match it exactly.
+const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+inline unsigned long long hashBytes(unsigned long long hash, const void* data, size_t length) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
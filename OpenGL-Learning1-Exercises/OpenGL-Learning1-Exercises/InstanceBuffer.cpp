@@ -0,0 +1,77 @@
+#include "InstanceBuffer.h"
+#include <cstring>
+
+void InstanceBuffer::create(GLStateCache& stateCache, unsigned int vao, unsigned int firstAttribute) {
+	this->firstAttribute = firstAttribute;
+	stateCache.bindVertexArray(vao);
+
+	glGenBuffers(1, &instanceVBO);
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+	// a mat4 attribute is fed as 4 vec4 columns, each advancing once per instance instead of once per vertex
+	pointAttributes(0);
+	for (unsigned int i = 0; i < 4; i++) {
+		glEnableVertexAttribArray(firstAttribute + i);
+		glVertexAttribDivisor(firstAttribute + i, 1);
+	}
+
+	stateCache.bindVertexArray(0);
+}
+
+// points the four columns at matrices starting offset bytes into the bound GL_ARRAY_BUFFER
+void InstanceBuffer::pointAttributes(size_t offset) {
+	for (unsigned int i = 0; i < 4; i++) {
+		glVertexAttribPointer(firstAttribute + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + i * sizeof(glm::vec4)));
+	}
+}
+
+void InstanceBuffer::upload(GLStateCache& stateCache, const glm::mat4* models, int count) {
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	if (count > capacity) {
+		glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), models, GL_DYNAMIC_DRAW);
+		capacity = count;
+	}
+	else {
+		// orphan the old storage so the driver doesn't have to wait for draws still reading it
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), models);
+	}
+	if (attributesOnStream) {
+		pointAttributes(0);
+		attributesOnStream = false;
+	}
+	instanceCount = count;
+}
+
+void InstanceBuffer::stream(GLStateCache& stateCache, StreamBuffer& streamBuffer, const glm::mat4* models, int count) {
+	size_t gpuOffset;
+	void* destination = streamBuffer.map(count * sizeof(glm::mat4), sizeof(glm::mat4), gpuOffset);
+	if (!destination) {
+		// larger than what is left of the frame's region, or the map failed: the batch still gets drawn
+		upload(stateCache, models, count);
+		return;
+	}
+	memcpy(destination, models, count * sizeof(glm::mat4));
+	streamBuffer.unmap();
+
+	// GL 3.3 has no base instance, so the attributes are re-pointed at this frame's data instead
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, streamBuffer.getBuffer());
+	pointAttributes(gpuOffset);
+	attributesOnStream = true;
+	instanceCount = count;
+}
+
+void InstanceBuffer::drawArrays(GLenum mode, int first, int vertexCount) const {
+	glDrawArraysInstanced(mode, first, vertexCount, instanceCount);
+}
+
+void InstanceBuffer::drawElements(GLenum mode, int indexCount, GLenum indexType, const void* indices) const {
+	glDrawElementsInstanced(mode, indexCount, indexType, indices, instanceCount);
+}
+
+void InstanceBuffer::destroy() {
+	glDeleteBuffers(1, &instanceVBO);
+	instanceVBO = 0;
+	instanceCount = 0;
+	capacity = 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "StateCache.h"
+#include "StreamBuffer.h"
+
+// Holds one model matrix per instance in a vertex buffer. The matrix occupies four consecutive
+// attribute locations (one vec4 column each) with a divisor of 1, so a single instanced draw call
+// replaces the per-object uniform upload + draw loop.
+class InstanceBuffer {
+private:
+	unsigned int instanceVBO = 0;
+	unsigned int firstAttribute = 0;
+	int instanceCount = 0;
+	int capacity = 0;
+	bool attributesOnStream = false; // stream() left the attributes pointing into the stream buffer
+
+	void pointAttributes(size_t offset);
+
+public:
+	// Binds go through the state cache so its shadow of the VAO and GL_ARRAY_BUFFER stays accurate.
+	void create(GLStateCache& stateCache, unsigned int vao, unsigned int firstAttribute);
+	// Copies the matrices into the buffer's own storage. The VAO this buffer was created for must be bound.
+	void upload(GLStateCache& stateCache, const glm::mat4* models, int count);
+	// Writes the matrices into this frame's slice of the stream buffer and points the instance
+	// attributes at it, or falls back to upload() when the stream buffer can't take them. The VAO this
+	// buffer was created for must be bound.
+	void stream(GLStateCache& stateCache, StreamBuffer& streamBuffer, const glm::mat4* models, int count);
+	void drawArrays(GLenum mode, int first, int vertexCount) const;
+	void drawElements(GLenum mode, int indexCount, GLenum indexType, const void* indices) const;
+	void destroy();
+
+	int getInstanceCount() const { return instanceCount; }
+	unsigned int getBuffer() const { return instanceVBO; }
+};
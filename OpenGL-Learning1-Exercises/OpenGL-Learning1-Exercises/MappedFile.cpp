@@ -0,0 +1,80 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// mmap can't map zero bytes, so empty files all point at this
+static const char emptyFile[1] = { 0 };
+
+bool MappedFile::open(const char* path) {
+	close();
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+	if (size == 0) {
+		data = emptyFile;
+		return true;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	data = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+	int descriptor = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (descriptor < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(descriptor, &info) != 0) {
+		::close(descriptor);
+		return false;
+	}
+	size = (size_t)info.st_size;
+	if (size == 0) {
+		data = emptyFile;
+	}
+	else {
+		void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		data = address == MAP_FAILED ? nullptr : (const char*)address;
+	}
+	// the mapping keeps its own reference to the file
+	::close(descriptor);
+#endif
+	if (!data) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (data && data != emptyFile) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	if (file) {
+		CloseHandle(file);
+	}
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data && data != emptyFile) {
+		munmap((void*)data, size);
+	}
+#endif
+	data = nullptr;
+	size = 0;
+}
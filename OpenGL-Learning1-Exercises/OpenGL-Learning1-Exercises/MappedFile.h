@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The contents are paged in by the OS on first touch
+// instead of being copied through a stream. Not copyable; the mapping lives as long as the object.
+class MappedFile {
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { close(); }
+
+	bool open(const char* path);
+	void close();
+
+	bool isOpen() const { return data != nullptr; }
+	// not null terminated
+	const char* getData() const { return data; }
+	size_t getSize() const { return size; }
+};
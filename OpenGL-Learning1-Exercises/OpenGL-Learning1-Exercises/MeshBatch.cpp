@@ -0,0 +1,166 @@
+#include "MeshBatch.h"
+#include "GLExtensions.h"
+
+static const unsigned int INSTANCE_ATTRIBUTE = 3;
+static const unsigned int LAYER_ATTRIBUTE = 7;
+
+unsigned int MeshBatch::addMesh(const float* meshVertices, unsigned int vertexCount, const unsigned int* meshIndices, unsigned int indexCount) {
+	MeshRange range;
+	range.firstIndex = (unsigned int)indices.size();
+	range.indexCount = indexCount;
+	range.baseVertex = (int)(vertices.size() / FLOATS_PER_VERTEX);
+
+	vertices.insert(vertices.end(), meshVertices, meshVertices + vertexCount * FLOATS_PER_VERTEX);
+	// indices stay mesh-relative, baseVertex offsets them at draw time
+	indices.insert(indices.end(), meshIndices, meshIndices + indexCount);
+
+	meshes.push_back(range);
+	return (unsigned int)meshes.size() - 1;
+}
+
+void MeshBatch::finalize(GLStateCache& stateCache) {
+	glGenVertexArrays(1, &vao);
+	stateCache.bindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+
+	glGenBuffers(1, &ebo);
+	stateCache.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &instanceVBO);
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (unsigned int i = 0; i < 4; i++) {
+		glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+		glVertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 1);
+	}
+	glGenBuffers(1, &layerVBO);
+	glEnableVertexAttribArray(LAYER_ATTRIBUTE);
+	glVertexAttribDivisor(LAYER_ATTRIBUTE, 1);
+	pointInstanceAttributes(stateCache, 0);
+
+	stateCache.bindVertexArray(0);
+
+	glGenBuffers(1, &indirectBuffer);
+
+	// the CPU copies are only needed until the upload
+	vertices.clear();
+	vertices.shrink_to_fit();
+	indices.clear();
+	indices.shrink_to_fit();
+
+	setPath(MULTI_DRAW_INDIRECT);
+}
+
+void MeshBatch::destroy() {
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ebo);
+	glDeleteBuffers(1, &instanceVBO);
+	glDeleteBuffers(1, &layerVBO);
+	glDeleteBuffers(1, &indirectBuffer);
+	vao = vbo = ebo = instanceVBO = layerVBO = indirectBuffer = 0;
+}
+
+void MeshBatch::setPath(MultiDrawPath drawPath) {
+	path = drawPath;
+	if (path == MULTI_DRAW_INDIRECT && !(glExtensions.hasMultiDrawIndirect && glExtensions.hasBaseInstance)) {
+		path = MULTI_DRAW_BASE_INSTANCE;
+	}
+	if (path == MULTI_DRAW_BASE_INSTANCE && !glExtensions.hasBaseInstance) {
+		path = MULTI_DRAW_BASE_VERTEX;
+	}
+}
+
+void MeshBatch::pointInstanceAttributes(GLStateCache& stateCache, size_t firstInstance) {
+	// expects the batch's VAO bound, leaves layerVBO bound to GL_ARRAY_BUFFER
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (unsigned int i = 0; i < 4; i++) {
+		glVertexAttribPointer(INSTANCE_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(firstInstance * sizeof(glm::mat4) + i * sizeof(glm::vec4)));
+	}
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, layerVBO);
+	glVertexAttribPointer(LAYER_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)(firstInstance * sizeof(glm::vec2)));
+}
+
+void MeshBatch::clear() {
+	commands.clear();
+	instanceModels.clear();
+	instanceLayers.clear();
+}
+
+void MeshBatch::add(unsigned int mesh, const glm::mat4* models, unsigned int count, const glm::vec2* textureLayers) {
+	const MeshRange& range = meshes[mesh];
+	DrawElementsIndirectCommand command;
+	command.count = range.indexCount;
+	command.instanceCount = count;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = range.baseVertex;
+	command.baseInstance = (unsigned int)instanceModels.size();
+	commands.push_back(command);
+	instanceModels.insert(instanceModels.end(), models, models + count);
+	if (textureLayers) {
+		instanceLayers.insert(instanceLayers.end(), textureLayers, textureLayers + count);
+	}
+	else {
+		instanceLayers.resize(instanceModels.size(), glm::vec2(0.0f));
+	}
+}
+
+void MeshBatch::submit(GLStateCache& stateCache, GLenum mode) {
+	lastApiCalls = 0;
+	if (commands.empty()) {
+		return;
+	}
+
+	// the VAO doesn't record GL_ARRAY_BUFFER itself, only the attribute pointers made while it was bound
+	stateCache.bindVertexArray(vao);
+	if (instanceModels.size() > instanceCapacity) {
+		instanceCapacity = instanceModels.size();
+	}
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instanceModels.size() * sizeof(glm::mat4), instanceModels.data());
+	stateCache.bindBuffer(GL_ARRAY_BUFFER, layerVBO);
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::vec2), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instanceLayers.size() * sizeof(glm::vec2), instanceLayers.data());
+	lastApiCalls += 6;
+
+	if (path == MULTI_DRAW_INDIRECT) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		if (commands.size() > commandCapacity) {
+			commandCapacity = commands.size();
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW);
+		}
+		else {
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+		}
+		glExtensions.multiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (void*)0, (GLsizei)commands.size(), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		lastApiCalls += 5;
+	}
+	else if (path == MULTI_DRAW_BASE_INSTANCE) {
+		for (size_t i = 0; i < commands.size(); i++) {
+			const DrawElementsIndirectCommand& command = commands[i];
+			glExtensions.drawElementsInstancedBaseVertexBaseInstance(mode, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(unsigned int)),
+				command.instanceCount, command.baseVertex, command.baseInstance);
+		}
+		lastApiCalls += (unsigned int)commands.size();
+	}
+	else {
+		for (size_t i = 0; i < commands.size(); i++) {
+			const DrawElementsIndirectCommand& command = commands[i];
+			pointInstanceAttributes(stateCache, command.baseInstance);
+			glDrawElementsInstancedBaseVertex(mode, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(unsigned int)),
+				command.instanceCount, command.baseVertex);
+		}
+		pointInstanceAttributes(stateCache, 0);
+		lastApiCalls += (unsigned int)commands.size() * 7 + 6;
+	}
+}
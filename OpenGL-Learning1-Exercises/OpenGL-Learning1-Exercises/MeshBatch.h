@@ -0,0 +1,78 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "StateCache.h"
+
+// Matches the layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER.
+struct DrawElementsIndirectCommand {
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int baseInstance;
+};
+
+// Where a mesh lives inside the batch's shared vertex and index buffers.
+struct MeshRange {
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	int baseVertex;
+};
+
+enum MultiDrawPath {
+	MULTI_DRAW_INDIRECT,       // one glMultiDrawElementsIndirect for the whole list
+	MULTI_DRAW_BASE_INSTANCE,  // one glDrawElementsInstancedBaseVertexBaseInstance per command
+	MULTI_DRAW_BASE_VERTEX     // GL 3.3: instance attributes re-pointed + glDrawElementsInstancedBaseVertex per command
+};
+
+// Many meshes with the same vertex format (position + texture coordinates, like the cube in
+// Render.cpp) packed into one VAO, drawn from a list of indirect commands. Each command's
+// baseInstance indexes the per-instance model matrices at attribute locations 3-6 and the
+// per-instance texture array layers at location 7, so the shader reaches its per-draw data
+// without any uniform or texture changes between draws.
+class MeshBatch {
+private:
+	unsigned int vao = 0;
+	unsigned int vbo = 0;
+	unsigned int ebo = 0;
+	unsigned int instanceVBO = 0;
+	unsigned int layerVBO = 0;
+	unsigned int indirectBuffer = 0;
+
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<MeshRange> meshes;
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<glm::mat4> instanceModels;
+	std::vector<glm::vec2> instanceLayers;
+	size_t instanceCapacity = 0;
+	size_t commandCapacity = 0;
+
+	MultiDrawPath path = MULTI_DRAW_BASE_VERTEX;
+	unsigned int lastApiCalls = 0;
+
+	void pointInstanceAttributes(GLStateCache& stateCache, size_t firstInstance);
+
+public:
+	static const int FLOATS_PER_VERTEX = 5;
+
+	// Meshes are added before finalize() uploads them; the returned id is used with add().
+	unsigned int addMesh(const float* meshVertices, unsigned int vertexCount, const unsigned int* meshIndices, unsigned int indexCount);
+	void finalize(GLStateCache& stateCache);
+	void destroy();
+
+	void clear();
+	// textureLayers holds two texture array layers per instance (x = base, y = overlay), or null for layer 0.
+	void add(unsigned int mesh, const glm::mat4* models, unsigned int count, const glm::vec2* textureLayers = nullptr);
+	void submit(GLStateCache& stateCache, GLenum mode = GL_TRIANGLES);
+
+	// Picks the best path the context supports; can be lowered to compare paths.
+	void setPath(MultiDrawPath drawPath);
+	MultiDrawPath getPath() const { return path; }
+	unsigned int getVAO() const { return vao; }
+	unsigned int getLastApiCalls() const { return lastApiCalls; }
+	size_t getCommandCount() const { return commands.size(); }
+};
@@ -0,0 +1,241 @@
+#include "MeshProcessing.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+IndexedMesh weldVertices(const float* vertices, size_t vertexCount, int floatsPerVertex) {
+	IndexedMesh mesh;
+	mesh.floatsPerVertex = floatsPerVertex;
+	mesh.indices.reserve(vertexCount);
+	size_t vertexBytes = floatsPerVertex * sizeof(float);
+
+	// open addressing over the welded vertices, keyed by a hash of the raw vertex bytes
+	size_t slotCount = 16;
+	while (slotCount < vertexCount * 2) {
+		slotCount <<= 1;
+	}
+	std::vector<unsigned int> slots(slotCount, 0xFFFFFFFFu);
+
+	for (size_t i = 0; i < vertexCount; i++) {
+		const float* vertex = vertices + i * floatsPerVertex;
+		const unsigned char* bytes = (const unsigned char*)vertex;
+		size_t hash = 14695981039346656037ull;
+		for (size_t b = 0; b < vertexBytes; b++) {
+			hash = (hash ^ bytes[b]) * 1099511628211ull;
+		}
+
+		size_t slot = hash & (slotCount - 1);
+		while (slots[slot] != 0xFFFFFFFFu) {
+			if (memcmp(&mesh.vertices[slots[slot] * floatsPerVertex], vertex, vertexBytes) == 0) {
+				break;
+			}
+			slot = (slot + 1) & (slotCount - 1);
+		}
+		if (slots[slot] == 0xFFFFFFFFu) {
+			slots[slot] = (unsigned int)mesh.vertexCount();
+			mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + floatsPerVertex);
+		}
+		mesh.indices.push_back(slots[slot]);
+	}
+	return mesh;
+}
+
+static const int FORSYTH_CACHE_SIZE = 32;
+
+static float forsythVertexScore(int cachePosition, int remainingTriangles) {
+	if (remainingTriangles == 0) {
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			// the last triangle's vertices get a fixed score so its neighbours aren't favoured over strips
+			score = 0.75f;
+		}
+		else {
+			float scale = 1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3);
+			score = powf(scale, 1.5f);
+		}
+	}
+	// vertices with few triangles left are worth finishing off
+	return score + 2.0f / sqrtf((float)remainingTriangles);
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// vertex -> triangles adjacency in one flat array
+	std::vector<unsigned int> triangleOffsets(vertexCount + 1, 0);
+	for (unsigned int index : indices) {
+		triangleOffsets[index + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++) {
+		triangleOffsets[v + 1] += triangleOffsets[v];
+	}
+	std::vector<unsigned int> vertexTriangles(indices.size());
+	std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (int corner = 0; corner < 3; corner++) {
+			vertexTriangles[fill[indices[t * 3 + corner]]++] = (unsigned int)t;
+		}
+	}
+
+	std::vector<int> remaining(vertexCount);
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		remaining[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+		vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+	}
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+	size_t scanCursor = 0;
+
+	long bestTriangle = -1;
+	while (output.size() < indices.size()) {
+		if (bestTriangle < 0) {
+			// nothing adjacent to the cache left: take the best remaining triangle
+			float bestScore = -1e30f;
+			for (size_t t = scanCursor; t < triangleCount; t++) {
+				if (!emitted[t] && triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					bestTriangle = (long)t;
+				}
+			}
+			while (scanCursor < triangleCount && emitted[scanCursor]) {
+				scanCursor++;
+			}
+		}
+
+		emitted[bestTriangle] = true;
+		newCache.clear();
+		for (int corner = 0; corner < 3; corner++) {
+			unsigned int v = indices[bestTriangle * 3 + corner];
+			output.push_back(v);
+			newCache.push_back(v);
+			remaining[v]--;
+			// drop the emitted triangle from the vertex's adjacency
+			unsigned int* begin = &vertexTriangles[triangleOffsets[v]];
+			for (int i = 0; i <= remaining[v]; i++) {
+				if (begin[i] == (unsigned int)bestTriangle) {
+					begin[i] = begin[remaining[v]];
+					break;
+				}
+			}
+		}
+		for (unsigned int v : cache) {
+			if (v != newCache[0] && v != newCache[1] && v != newCache[2]) {
+				newCache.push_back(v);
+			}
+		}
+		// vertices pushed out of the cache lose their cache bonus
+		for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); i++) {
+			cachePosition[newCache[i]] = -1;
+			vertexScore[newCache[i]] = forsythVertexScore(-1, remaining[newCache[i]]);
+		}
+		if (newCache.size() > (size_t)FORSYTH_CACHE_SIZE) {
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		}
+		cache.swap(newCache);
+
+		// rescore the cached vertices and their pending triangles, remembering the best one
+		for (size_t i = 0; i < cache.size(); i++) {
+			cachePosition[cache[i]] = (int)i;
+			vertexScore[cache[i]] = forsythVertexScore((int)i, remaining[cache[i]]);
+		}
+		bestTriangle = -1;
+		float bestScore = -1e30f;
+		for (unsigned int v : cache) {
+			for (int i = 0; i < remaining[v]; i++) {
+				unsigned int t = vertexTriangles[triangleOffsets[v] + i];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					bestTriangle = (long)t;
+				}
+			}
+		}
+	}
+	indices.swap(output);
+}
+
+void optimizeVertexFetch(IndexedMesh& mesh) {
+	size_t vertexCount = mesh.vertexCount();
+	std::vector<unsigned int> remap(vertexCount, 0xFFFFFFFFu);
+	std::vector<float> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (unsigned int& index : mesh.indices) {
+		if (remap[index] == 0xFFFFFFFFu) {
+			remap[index] = (unsigned int)(vertices.size() / mesh.floatsPerVertex);
+			const float* vertex = &mesh.vertices[index * mesh.floatsPerVertex];
+			vertices.insert(vertices.end(), vertex, vertex + mesh.floatsPerVertex);
+		}
+		index = remap[index];
+	}
+	// unreferenced vertices are dropped
+	mesh.vertices.swap(vertices);
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize) {
+	std::vector<unsigned int> fifo(cacheSize, 0xFFFFFFFFu);
+	std::vector<bool> referenced(vertexCount, false);
+	size_t head = 0;
+	size_t transformed = 0;
+	size_t unique = 0;
+
+	for (unsigned int index : indices) {
+		if (!referenced[index]) {
+			referenced[index] = true;
+			unique++;
+		}
+		bool hit = false;
+		for (int i = 0; i < cacheSize; i++) {
+			if (fifo[i] == index) {
+				hit = true;
+				break;
+			}
+		}
+		if (!hit) {
+			fifo[head] = index;
+			head = (head + 1) % cacheSize;
+			transformed++;
+		}
+	}
+
+	VertexCacheStats stats;
+	stats.acmr = indices.empty() ? 0.0f : (float)transformed / (indices.size() / 3);
+	stats.atvr = unique == 0 ? 0.0f : (float)transformed / unique;
+	return stats;
+}
+
+IndexedMesh processMesh(const char* name, const float* vertices, size_t vertexCount, int floatsPerVertex) {
+	// the unprocessed triangle list transforms every corner
+	std::vector<unsigned int> identity(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		identity[i] = (unsigned int)i;
+	}
+	VertexCacheStats before = analyzeVertexCache(identity, vertexCount);
+
+	IndexedMesh mesh = weldVertices(vertices, vertexCount, floatsPerVertex);
+	optimizeVertexCache(mesh.indices, mesh.vertexCount());
+	optimizeVertexFetch(mesh);
+	VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertexCount());
+
+	std::cout << "MESH::" << name << " vertices " << vertexCount << " -> " << mesh.vertexCount()
+		<< ", ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+	return mesh;
+}
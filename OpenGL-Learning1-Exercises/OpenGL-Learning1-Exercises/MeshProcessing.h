@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Interleaved float vertices plus a triangle list indexing them.
+struct IndexedMesh {
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	int floatsPerVertex = 0;
+
+	size_t vertexCount() const { return floatsPerVertex ? vertices.size() / floatsPerVertex : 0; }
+};
+
+// Post-transform cache efficiency of an index order, simulated with a FIFO cache.
+// ACMR: vertex shader invocations per triangle (0.5 is ideal for large grids, 3 is no reuse).
+// ATVR: invocations per unique vertex (1 is ideal).
+struct VertexCacheStats {
+	float acmr;
+	float atvr;
+};
+
+// Merges bit-identical vertices of a non-indexed triangle list and emits the index buffer.
+IndexedMesh weldVertices(const float* vertices, size_t vertexCount, int floatsPerVertex);
+
+// Reorders triangles for the post-transform vertex cache (Forsyth's linear-speed optimizer).
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Reorders vertices into first-use order so vertex fetch walks the buffer sequentially.
+void optimizeVertexFetch(IndexedMesh& mesh);
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = 16);
+
+// Weld + cache + fetch optimization in one go, printing ACMR/ATVR before and after.
+IndexedMesh processMesh(const char* name, const float* vertices, size_t vertexCount, int floatsPerVertex);
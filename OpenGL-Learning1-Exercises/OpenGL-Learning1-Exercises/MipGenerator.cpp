@@ -0,0 +1,501 @@
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+// Radius of the windowed sinc filters, in output texels.
+static const float FILTER_RADIUS = 3.0f;
+static const float KAISER_ALPHA = 4.0f;
+static const double PI = 3.14159265358979323846;
+static const float MAX_COVERAGE_SCALE = 4.0f;
+
+// Which source texels make up each output texel of one axis. Every output has the same number of taps
+// so the kernels have no data-dependent loop counts; outputs that need fewer get zero weights, and
+// taps past the edge are clamped to it.
+struct FilterTaps {
+	int taps = 0;
+	std::vector<int> index;          // outputs * taps
+	std::vector<float> weight;       // outputs * taps, summing to 1 per output
+	std::vector<float> splatWeight;  // each weight repeated for the 4 channels, for the horizontal kernels
+};
+
+static double sinc(double x) {
+	if (std::fabs(x) < 1e-9) {
+		return 1.0;
+	}
+	return std::sin(PI * x) / (PI * x);
+}
+
+// zeroth order modified Bessel function of the first kind
+static double besselI0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32 && term > sum * 1e-12; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+// x in output texels from the output's centre.
+static double filterWeight(MipFilter filter, double x) {
+	if (std::fabs(x) >= FILTER_RADIUS) {
+		return 0.0;
+	}
+	double t = x / FILTER_RADIUS;
+	if (filter == MIP_FILTER_KAISER) {
+		return sinc(x) * besselI0(KAISER_ALPHA * std::sqrt(1.0 - t * t)) / besselI0(KAISER_ALPHA);
+	}
+	return sinc(x) * sinc(t);
+}
+
+static void computeTaps(int inSize, int outSize, MipFilter filter, FilterTaps& result) {
+	double ratio = (double)inSize / outSize;
+	double support = filter == MIP_FILTER_BOX ? ratio * 0.5 : FILTER_RADIUS * ratio;
+	// outputs sit at the same offset from their first texel whenever the ratio is a whole number, so the
+	// weights of the last offset seen are kept instead of evaluating the filter again for every output
+	std::vector<int> first(outSize);
+	std::vector<std::vector<double>> weights(outSize);
+	std::vector<double> pattern;
+	int patternLead = 0; // zero-weight texels skipped at the start of the pattern
+	double patternOffset = -1.0;
+	int taps = 1;
+	for (int out = 0; out < outSize; out++) {
+		double center = (out + 0.5) * ratio;
+		int start = (int)std::floor(center - support);
+		double offset = center - start;
+		if (offset != patternOffset) {
+			patternOffset = offset;
+			pattern.clear();
+			int span = (int)std::ceil(center + support) - start + 1;
+			double sum = 0.0;
+			for (int i = 0; i < span; i++) {
+				double weight;
+				if (filter == MIP_FILTER_BOX) {
+					// the part of texel i inside the output's footprint
+					weight = std::max(0.0, std::min(offset + support, i + 1.0) - std::max(offset - support, (double)i));
+				}
+				else {
+					weight = filterWeight(filter, (i + 0.5 - offset) / ratio);
+				}
+				pattern.push_back(std::fabs(weight) > 1e-7 ? weight : 0.0);
+				sum += pattern.back();
+			}
+			for (double& weight : pattern) {
+				weight /= sum;
+			}
+			while (pattern.back() == 0.0) {
+				pattern.pop_back();
+			}
+			patternLead = 0;
+			while (pattern[patternLead] == 0.0) {
+				patternLead++;
+			}
+			pattern.erase(pattern.begin(), pattern.begin() + patternLead);
+		}
+		first[out] = start + patternLead;
+		weights[out] = pattern;
+		taps = std::max(taps, (int)pattern.size());
+	}
+
+	result.taps = taps;
+	result.index.assign((size_t)outSize * taps, 0);
+	result.weight.assign((size_t)outSize * taps, 0.0f);
+	result.splatWeight.assign((size_t)outSize * taps * 4, 0.0f);
+	for (int out = 0; out < outSize; out++) {
+		int count = (int)weights[out].size();
+		for (int k = 0; k < taps; k++) {
+			size_t slot = (size_t)out * taps + k;
+			// taps past the edge are clamped to it, and padding repeats the last texel with no weight, so
+			// every index stays in range
+			int texel = first[out] + std::min(k, count - 1);
+			result.index[slot] = std::min(std::max(texel, 0), inSize - 1);
+			result.weight[slot] = k < count ? (float)weights[out][k] : 0.0f;
+			for (int channel = 0; channel < 4; channel++) {
+				result.splatWeight[slot * 4 + channel] = result.weight[slot];
+			}
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------
+// kernels; images are RGBA float whatever the source channel count, so a texel is one SSE register
+
+// One row, narrowed from inWidth to the outputs of taps.
+static void filterRowScalar(const float* in, const FilterTaps& taps, int outWidth, float* out) {
+	for (int x = 0; x < outWidth; x++) {
+		const int* index = &taps.index[(size_t)x * taps.taps];
+		const float* weight = &taps.weight[(size_t)x * taps.taps];
+		for (int channel = 0; channel < 4; channel++) {
+			float sum = 0.0f;
+			for (int k = 0; k < taps.taps; k++) {
+				sum += weight[k] * in[index[k] * 4 + channel];
+			}
+			out[x * 4 + channel] = sum;
+		}
+	}
+}
+
+static void filterRowSimd(const float* in, const FilterTaps& taps, int outWidth, float* out) {
+	int x = 0;
+#if defined(__AVX__)
+	// two outputs per register; their taps start at different texels, so each half is loaded on its own
+	for (; x + 2 <= outWidth; x += 2) {
+		const int* index0 = &taps.index[(size_t)x * taps.taps];
+		const int* index1 = index0 + taps.taps;
+		const float* weight0 = &taps.splatWeight[(size_t)x * taps.taps * 4];
+		const float* weight1 = weight0 + taps.taps * 4;
+		__m256 sum = _mm256_setzero_ps();
+		for (int k = 0; k < taps.taps; k++) {
+			__m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in + index0[k] * 4)), _mm_loadu_ps(in + index1[k] * 4), 1);
+			__m256 weights = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(weight0 + k * 4)), _mm_loadu_ps(weight1 + k * 4), 1);
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(weights, texels));
+		}
+		_mm256_storeu_ps(out + x * 4, sum);
+	}
+#endif
+	for (; x < outWidth; x++) {
+		const int* index = &taps.index[(size_t)x * taps.taps];
+		const float* weight = &taps.splatWeight[(size_t)x * taps.taps * 4];
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < taps.taps; k++) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(weight + k * 4), _mm_loadu_ps(in + index[k] * 4)));
+		}
+		_mm_storeu_ps(out + x * 4, sum);
+	}
+}
+
+// One output row as the weighted sum of whole input rows, count floats long.
+static void filterColumnsScalar(const float* const* rows, const float* weight, int taps, size_t count, float* out) {
+	for (size_t i = 0; i < count; i++) {
+		float sum = 0.0f;
+		for (int k = 0; k < taps; k++) {
+			sum += weight[k] * rows[k][i];
+		}
+		out[i] = sum;
+	}
+}
+
+static void filterColumnsSimd(const float* const* rows, const float* weight, int taps, size_t count, float* out) {
+	size_t i = 0;
+#if defined(__AVX__)
+	for (; i + 8 <= count; i += 8) {
+		__m256 sum = _mm256_setzero_ps();
+		for (int k = 0; k < taps; k++) {
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weight[k]), _mm256_loadu_ps(rows[k] + i)));
+		}
+		_mm256_storeu_ps(out + i, sum);
+	}
+#endif
+	// rows are whole RGBA texels, so what is left is a multiple of 4
+	for (; i + 4 <= count; i += 4) {
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < taps; k++) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(rows[k] + i)));
+		}
+		_mm_storeu_ps(out + i, sum);
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------
+// conversion to and from linear RGBA float
+
+static float srgbToLinear(float value) {
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value) {
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// 4096 buckets over [0, 1] are narrow enough that each spans at most two codes, even near black where
+// the curve is steepest, so encoding is a lookup and at most a step or two up the thresholds.
+static const int SRGB_BUCKETS = 4096;
+
+struct SrgbTables {
+	float toLinear[256];
+	float unorm8[256];
+	// toEncoded[k] is the linear value halfway between codes k and k + 1, so a code is the number of
+	// entries at or below the value; the last entry is never reached
+	float toEncoded[256];
+	unsigned char bucketCode[SRGB_BUCKETS + 1]; // code of each bucket's lower end
+
+	SrgbTables() {
+		for (int code = 0; code < 256; code++) {
+			toLinear[code] = srgbToLinear(code / 255.0f);
+			unorm8[code] = code / 255.0f;
+			toEncoded[code] = code < 255 ? srgbToLinear((code + 0.5f) / 255.0f) : FLT_MAX;
+		}
+		int code = 0;
+		for (int bucket = 0; bucket <= SRGB_BUCKETS; bucket++) {
+			float value = (float)bucket / SRGB_BUCKETS;
+			while (value >= toEncoded[code]) {
+				code++;
+			}
+			bucketCode[bucket] = (unsigned char)code;
+		}
+	}
+};
+
+static const SrgbTables& srgbTables() {
+	static const SrgbTables tables;
+	return tables;
+}
+
+// value must be in [0, 1].
+static unsigned char encodeSrgb8(const SrgbTables& tables, float value) {
+	int code = tables.bucketCode[(int)(value * SRGB_BUCKETS)];
+	while (value >= tables.toEncoded[code]) {
+		code++;
+	}
+	return (unsigned char)code;
+}
+
+static bool isColorChannel(int channel, int channels) {
+	return channels == 1 || channels == 3 || channel < channels - 1;
+}
+
+// Where a source channel goes in the RGBA texels the filters work on: alpha is always in the last slot.
+static int channelSlot(int channel, int channels) {
+	return channels == 2 && channel == 1 ? 3 : channel;
+}
+
+// Converts row y of the source. Slots the source has no channel for are left alone.
+static void convertRow(const void* pixels, int width, int channels, MipPixelType type, bool srgb, int y, float* out) {
+	size_t first = (size_t)y * width * channels;
+	for (int channel = 0; channel < channels; channel++) {
+		bool decode = srgb && isColorChannel(channel, channels);
+		float* slot = out + channelSlot(channel, channels);
+		if (type == MIP_PIXEL_UNORM8) {
+			// a lookup per value, through the sRGB or the plain table depending on the channel
+			const float* table = decode ? srgbTables().toLinear : srgbTables().unorm8;
+			const unsigned char* source = (const unsigned char*)pixels + first + channel;
+			for (int x = 0; x < width; x++) {
+				slot[x * 4] = table[source[x * channels]];
+			}
+		}
+		else if (type == MIP_PIXEL_UNORM16) {
+			const unsigned short* source = (const unsigned short*)pixels + first + channel;
+			for (int x = 0; x < width; x++) {
+				float value = source[x * channels] / 65535.0f;
+				slot[x * 4] = decode ? srgbToLinear(value) : value;
+			}
+		}
+		else {
+			const float* source = (const float*)pixels + first + channel;
+			for (int x = 0; x < width; x++) {
+				slot[x * 4] = source[x * channels];
+			}
+		}
+	}
+}
+
+static void storeLevel(const float* in, size_t count, int channels, MipPixelType type, bool srgb, float alphaScale, unsigned char* pixels) {
+	const SrgbTables& tables = srgbTables();
+	for (int channel = 0; channel < channels; channel++) {
+		bool color = isColorChannel(channel, channels);
+		bool encode = srgb && color;
+		float scale = color ? 1.0f : alphaScale;
+		const float* slot = in + channelSlot(channel, channels);
+		if (type == MIP_PIXEL_FLOAT) {
+			float* target = (float*)pixels + channel;
+			for (size_t i = 0; i < count; i++) {
+				target[i * channels] = slot[i * 4] * scale;
+			}
+			continue;
+		}
+		// sharpening filters overshoot, so everything is clamped before it's rounded
+		if (type == MIP_PIXEL_UNORM8) {
+			unsigned char* target = pixels + channel;
+			for (size_t i = 0; i < count; i++) {
+				float value = std::min(std::max(slot[i * 4] * scale, 0.0f), 1.0f);
+				target[i * channels] = encode ? encodeSrgb8(tables, value) : (unsigned char)(value * 255.0f + 0.5f);
+			}
+		}
+		else {
+			unsigned short* target = (unsigned short*)pixels + channel;
+			for (size_t i = 0; i < count; i++) {
+				float value = std::min(std::max(slot[i * 4] * scale, 0.0f), 1.0f);
+				target[i * channels] = (unsigned short)((encode ? linearToSrgb(value) : value) * 65535.0f + 0.5f);
+			}
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------
+
+// Filters one level into the next. Input rows come from rows(y, buffer), which either converts them from
+// the source into buffer or points into the previous level. Rows are narrowed horizontally as the
+// vertical taps first need them and kept in a ring with one slot per tap: the rows one output needs are
+// consecutive, so they never share a slot, and each input row is converted and narrowed once. Level 0
+// therefore never exists in float, and the working set stays a few rows.
+template <typename RowSource>
+static void downsample(RowSource rows, int inWidth, int inHeight, std::vector<float>& out, int outWidth, int outHeight, MipFilter filter, bool simd,
+	std::vector<float>& rowBuffer, std::vector<float>& ring) {
+	FilterTaps horizontal, vertical;
+	bool narrow = outWidth != inWidth;
+	if (narrow) {
+		computeTaps(inWidth, outWidth, filter, horizontal);
+	}
+	// a height that doesn't change ends up with one tap of weight 1
+	computeTaps(inHeight, outHeight, filter, vertical);
+
+	size_t rowFloats = (size_t)outWidth * 4;
+	int slots = vertical.taps;
+	ring.resize(slots * rowFloats);
+	std::vector<int> slotRow(slots, -1);
+	std::vector<const float*> tapRows(slots);
+	if (rowBuffer.size() < (size_t)inWidth * 4) {
+		rowBuffer.resize((size_t)inWidth * 4, 0.0f);
+	}
+	out.resize(rowFloats * outHeight);
+
+	for (int y = 0; y < outHeight; y++) {
+		for (int k = 0; k < vertical.taps; k++) {
+			int row = vertical.index[(size_t)y * vertical.taps + k];
+			int slot = row % slots;
+			float* narrowed = &ring[slot * rowFloats];
+			if (slotRow[slot] != row) {
+				const float* in = rows(row, rowBuffer.data());
+				if (!narrow) {
+					std::copy(in, in + rowFloats, narrowed);
+				}
+				else if (simd) {
+					filterRowSimd(in, horizontal, outWidth, narrowed);
+				}
+				else {
+					filterRowScalar(in, horizontal, outWidth, narrowed);
+				}
+				slotRow[slot] = row;
+			}
+			tapRows[k] = narrowed;
+		}
+		const float* weight = &vertical.weight[(size_t)y * vertical.taps];
+		if (simd) {
+			filterColumnsSimd(tapRows.data(), weight, vertical.taps, rowFloats, &out[y * rowFloats]);
+		}
+		else {
+			filterColumnsScalar(tapRows.data(), weight, vertical.taps, rowFloats, &out[y * rowFloats]);
+		}
+	}
+}
+
+// Texels whose alpha is above cutoff.
+static size_t alphaCovered(const float* rgba, size_t count, float cutoff) {
+	size_t covered = 0;
+	for (size_t i = 0; i < count; i++) {
+		covered += rgba[i * 4 + 3] > cutoff ? 1 : 0;
+	}
+	return covered;
+}
+
+// The alpha scale that puts targetCoverage of the texels above cutoff. The texel that has to be the last
+// one covered is found with a partial sort and scaled to just above the cutoff. Texels with the same
+// alpha can only be covered together, so when that value is shared the scale lands on whichever side of
+// it is closer to the target.
+static float coverageScale(const std::vector<float>& rgba, float cutoff, float targetCoverage, std::vector<float>& alphas) {
+	size_t count = rgba.size() / 4;
+	size_t covered = (size_t)(targetCoverage * count + 0.5f);
+	if (covered == 0 || count == 0) {
+		return 1.0f;
+	}
+	alphas.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		alphas[i] = rgba[i * 4 + 3];
+	}
+	std::nth_element(alphas.begin(), alphas.begin() + (covered - 1), alphas.end(), std::greater<float>());
+	float alpha = alphas[covered - 1];
+	// capped, so a level that has almost faded out isn't blown up into solid blocks
+	if (alpha <= cutoff / MAX_COVERAGE_SCALE) {
+		return MAX_COVERAGE_SCALE;
+	}
+	size_t above = 0, equal = 0;
+	for (float value : alphas) {
+		above += value > alpha ? 1 : 0;
+		equal += value == alpha ? 1 : 0;
+	}
+	if (covered - above < above + equal - covered && above > 0) {
+		return std::nextafter(cutoff / alpha, 0.0f);
+	}
+	return std::nextafter(cutoff / alpha, FLT_MAX);
+}
+
+// ---------------------------------------------------------------------------------------------------
+
+int mipLevelCount(int width, int height) {
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		levels++;
+	}
+	return levels;
+}
+
+std::vector<MipLevel> generateMips(const void* pixels, int width, int height, int channels, MipPixelType type, const MipSettings& settings) {
+	std::vector<MipLevel> levels;
+	if (!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+		return levels;
+	}
+	bool srgb = settings.srgb && type != MIP_PIXEL_FLOAT;
+	size_t bytesPerValue = type == MIP_PIXEL_UNORM8 ? 1 : type == MIP_PIXEL_UNORM16 ? 2 : 4;
+	bool coverage = settings.preserveAlphaCoverage && (channels == 2 || channels == 4);
+
+	std::vector<float> current, next, rowBuffer((size_t)width * 4, 0.0f), ring, alphas;
+	float targetCoverage = 0.0f;
+	if (coverage) {
+		size_t covered = 0;
+		for (int y = 0; y < height; y++) {
+			convertRow(pixels, width, channels, type, srgb, y, rowBuffer.data());
+			covered += alphaCovered(rowBuffer.data(), width, settings.alphaCutoff);
+		}
+		targetCoverage = (float)covered / ((size_t)width * height);
+	}
+
+	while (width > 1 || height > 1) {
+		int nextWidth = std::max(1, width / 2);
+		int nextHeight = std::max(1, height / 2);
+		if (levels.empty()) {
+			downsample([&](int y, float* buffer) -> const float* {
+				convertRow(pixels, width, channels, type, srgb, y, buffer);
+				return buffer;
+			}, width, height, next, nextWidth, nextHeight, settings.filter, settings.simd, rowBuffer, ring);
+		}
+		else {
+			size_t rowFloats = (size_t)width * 4;
+			downsample([&](int y, float*) -> const float* {
+				return &current[y * rowFloats];
+			}, width, height, next, nextWidth, nextHeight, settings.filter, settings.simd, rowBuffer, ring);
+		}
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+
+		float alphaScale = coverage ? coverageScale(current, settings.alphaCutoff, targetCoverage, alphas) : 1.0f;
+		MipLevel level;
+		level.width = width;
+		level.height = height;
+		level.pixels = (unsigned char*)malloc((size_t)width * height * channels * bytesPerValue);
+		storeLevel(current.data(), (size_t)width * height, channels, type, srgb, alphaScale, level.pixels);
+		levels.push_back(level);
+	}
+	return levels;
+}
+
+void freeMipPixels(void* pixels) {
+	free(pixels);
+}
+
+void freeMips(std::vector<MipLevel>& levels) {
+	for (MipLevel& level : levels) {
+		freeMipPixels(level.pixels);
+	}
+	levels.clear();
+}
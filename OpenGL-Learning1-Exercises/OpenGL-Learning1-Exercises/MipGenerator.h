@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+
+enum MipPixelType {
+	MIP_PIXEL_UNORM8,
+	MIP_PIXEL_UNORM16,
+	MIP_PIXEL_FLOAT
+};
+
+enum MipFilter {
+	MIP_FILTER_BOX,    // average of the texels each output covers; soft, the cheapest
+	MIP_FILTER_KAISER, // Kaiser-windowed sinc, 3 lobes: sharper than box with very little ringing
+	MIP_FILTER_LANCZOS // Lanczos 3: the sharpest, rings slightly around hard edges
+};
+
+struct MipSettings {
+	MipFilter filter = MIP_FILTER_BOX;
+	// colour channels are sRGB encoded, so they are filtered in linear light and encoded again; ignored
+	// for float images, which are taken to be linear already
+	bool srgb = false;
+	// scales the alpha of every level so the share of texels above alphaCutoff stays what it is in level
+	// 0; without it alpha-tested edges thin out and vanish in the distance
+	bool preserveAlphaCoverage = false;
+	float alphaCutoff = 0.5f;
+	bool simd = true; // false runs the scalar kernels, which the SIMD ones are checked against
+};
+
+struct MipLevel {
+	int width;
+	int height;
+	unsigned char* pixels; // same layout and channel count as the source, freed with freeMipPixels
+};
+
+// Levels of a full chain down to 1x1, level 0 included.
+int mipLevelCount(int width, int height);
+
+// Builds levels 1 and down of an image whose rows are tightly packed, channels values per pixel. With
+// 2 or 4 channels the last one is alpha, the rest are colour, like stbi returns them. Every level is
+// filtered from the previous one in 32-bit float with separable kernels, SSE2 or AVX when the build
+// enables it, and only rounded to the output type once, so errors don't accumulate down the chain.
+// Sizes halve and round down like GL's, with odd sizes weighted by how much of each texel an output
+// covers. Keeps no state, so any number of threads can call it at once, e.g. the TextureLoader workers.
+std::vector<MipLevel> generateMips(const void* pixels, int width, int height, int channels, MipPixelType type, const MipSettings& settings);
+
+void freeMipPixels(void* pixels);
+void freeMips(std::vector<MipLevel>& levels);
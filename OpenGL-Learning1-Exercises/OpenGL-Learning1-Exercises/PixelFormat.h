@@ -0,0 +1,22 @@
+#pragma once
+#include <glad/glad.h>
+
+// GL pixel transfer format of an 8-bit image with the given channel count, as stb_image decodes them.
+inline GLenum formatForChannels(int channels) {
+	switch (channels) {
+	case 1: return GL_RED;
+	case 2: return GL_RG;
+	case 3: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+// Decoded images have tightly packed rows, and the rows of an RGB image aren't 4-byte aligned in
+// general, so uploads from them are bracketed by these two.
+inline void beginPackedRowUploads() {
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+}
+
+inline void endPackedRowUploads() {
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -0,0 +1,142 @@
+#include "ProgramBinaryCache.h"
+#include "GLExtensions.h"
+#include "Hash.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const unsigned int PROGRAM_BINARY_MAGIC = 0x42504C47; // "GLPB"
+
+struct ProgramBinaryHeader {
+	unsigned int magic;
+	unsigned int format;
+	unsigned int length;
+	unsigned int pad;
+	unsigned long long key;
+	unsigned long long checksum;
+};
+
+void ProgramBinaryCacheStats::print(const char* label) const {
+	std::cout << "SHADER_CACHE::" << label << " " << hits << " hits, " << misses << " misses, " << rejected << " rejected, "
+		<< stored << " stored, " << buildMs << " ms building programs" << std::endl;
+}
+
+void ProgramBinaryCache::init(const char* cacheDirectory) {
+	directory = cacheDirectory;
+	enabled = glExtensions.hasProgramBinary;
+	if (!enabled) {
+		return;
+	}
+	driverId = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+}
+
+unsigned long long ProgramBinaryCache::hashKey(const unsigned long long* sourceHashes, int stageCount) const {
+	unsigned long long hash = hashBytes(FNV_OFFSET_BASIS, driverId.data(), driverId.size());
+	return hashBytes(hash, sourceHashes, stageCount * sizeof(unsigned long long));
+}
+
+std::string ProgramBinaryCache::entryPath(unsigned long long key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", key);
+	return directory + "/" + name;
+}
+
+void ProgramBinaryCache::prepareProgram(unsigned int program) const {
+	if (enabled) {
+		glExtensions.programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+bool ProgramBinaryCache::load(unsigned long long key, unsigned int program) {
+	if (!enabled) {
+		return false;
+	}
+	std::string path = entryPath(key);
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) {
+		stats.misses++;
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	ProgramBinaryHeader header;
+	std::vector<unsigned char> binary;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == PROGRAM_BINARY_MAGIC && header.key == key;
+	// the length comes from the file, so it's checked against what the file holds before anything is allocated
+	valid = valid && fileSize >= (long)sizeof(header) && header.length == (unsigned long)fileSize - sizeof(header);
+	if (valid) {
+		binary.resize(header.length);
+		valid = header.length > 0 && fread(binary.data(), 1, binary.size(), file) == binary.size()
+			&& hashBytes(FNV_OFFSET_BASIS, binary.data(), binary.size()) == header.checksum;
+	}
+	fclose(file);
+
+	if (valid) {
+		glExtensions.programBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+		int success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		valid = success != 0;
+	}
+	if (!valid) {
+		std::cout << "ERROR::SHADER_CACHE::REJECTED_BINARY " << path << std::endl;
+		remove(path.c_str());
+		stats.rejected++;
+		stats.misses++;
+		return false;
+	}
+	stats.hits++;
+	return true;
+}
+
+void ProgramBinaryCache::store(unsigned long long key, unsigned int program) {
+	if (!enabled) {
+		return;
+	}
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	std::vector<unsigned char> binary(length);
+	GLenum format = 0;
+	glExtensions.getProgramBinary(program, length, &length, &format, binary.data());
+
+	ProgramBinaryHeader header = {};
+	header.magic = PROGRAM_BINARY_MAGIC;
+	header.format = format;
+	header.length = (unsigned int)length;
+	header.key = key;
+	header.checksum = hashBytes(FNV_OFFSET_BASIS, binary.data(), length);
+
+	// write to a temporary name first so a crash never leaves a truncated entry under the real one
+	std::string path = entryPath(key);
+	std::string tempPath = path + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (!file) {
+		std::cout << "ERROR::SHADER_CACHE::WRITE_FAILED " << tempPath << std::endl;
+		return;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, length, file) == (size_t)length;
+	fclose(file);
+	remove(path.c_str());
+	if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+		std::cout << "ERROR::SHADER_CACHE::WRITE_FAILED " << path << std::endl;
+		remove(tempPath.c_str());
+		return;
+	}
+	stats.stored++;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+
+#define PROGRAM_BINARY_CACHE_DIRECTORY "ShaderCache"
+
+struct ProgramBinaryCacheStats {
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int rejected = 0; // entries that were found but unreadable or refused by the driver
+	unsigned int stored = 0;
+	double buildMs = 0.0; // total time spent in ShaderLoader::createShaderProgram, hit or miss
+
+	void print(const char* label) const;
+};
+
+// Linked program binaries on disk, one file per program named after a 64-bit key. The key covers the
+// shader sources and the GL_VENDOR/GL_RENDERER/GL_VERSION strings, so a driver update or a different
+// GPU simply misses instead of loading a binary the driver would have to reject.
+// Each file starts with a small header (magic, binary format, length, key, checksum); anything that
+// fails to validate, or that glProgramBinary refuses to link, is deleted and the caller recompiles.
+// Requires GL 4.1 / ARB_get_program_binary; without it every lookup misses and nothing is written.
+class ProgramBinaryCache {
+private:
+	std::string directory;
+	std::string driverId;
+	bool enabled = false;
+	ProgramBinaryCacheStats stats;
+
+	std::string entryPath(unsigned long long key) const;
+
+public:
+	// Call once the context is current and loadGLExtensions has run. Creates the directory if needed.
+	void init(const char* cacheDirectory = PROGRAM_BINARY_CACHE_DIRECTORY);
+
+	// sourceHashes holds one PreprocessedSource::hash per stage, in stage order.
+	unsigned long long hashKey(const unsigned long long* sourceHashes, int stageCount) const;
+
+	// Must be called before linking for the driver to keep a retrievable binary around.
+	void prepareProgram(unsigned int program) const;
+
+	// Loads the binary for key into program. Returns false on a miss or a rejected entry, in which
+	// case program is left unlinked and should be built from source.
+	bool load(unsigned long long key, unsigned int program);
+	void store(unsigned long long key, unsigned int program);
+
+	void addBuildTime(double ms) { stats.buildMs += ms; }
+	bool isEnabled() const { return enabled; }
+	const ProgramBinaryCacheStats& getStats() const { return stats; }
+};
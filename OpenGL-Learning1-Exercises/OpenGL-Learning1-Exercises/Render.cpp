@@ -6,11 +6,37 @@
 #include <glm/ext/matrix_clip_space.hpp>
 
 #include "Shaders.h"
-#include "stb_image.h"
 #include <glm/gtc/type_ptr.hpp>
 #include "Camera.h"
+#include "InstanceBuffer.h"
+#include "Benchmarks.h"
+#include "FrameConstants.h"
+#include "StateCache.h"
+#include "RenderQueue.h"
+#include "StreamBuffer.h"
+#include "GLExtensions.h"
+#include "MeshBatch.h"
+#include "FrustumCuller.h"
+#include "TextureArray.h"
+#include "MeshProcessing.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderWatcher.h"
+#include "GpuCuller.h"
+#include "TextureLoader.h"
+#include "TextureUploader.h"
+#include "CompressedTexture.h"
+#include "stb_image.h"
 
 bool isWireFrame = false;
+// how the cubes are submitted, cycled with the I key
+enum RenderMode {
+	RENDER_PER_CUBE,   // one uniform upload + draw call per cube
+	RENDER_QUEUE,      // sorted render queue, merged into instanced draws
+	RENDER_MULTI_DRAW, // shared mesh batch drawn with indirect commands
+	RENDER_GPU_CULLED, // culled by a compute shader and drawn indirectly; per cube without GL 4.3
+	RENDER_MODE_COUNT
+};
+RenderMode renderMode = RENDER_QUEUE;
 
 float deltaTime = 0.0f; // Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
@@ -20,6 +46,7 @@ float lastYPos = 0.0f;
 bool firstMouse = true;
 
 Camera* camera;
+GLStateCache* stateCache;
 
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
@@ -48,6 +75,54 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
 
 
 
+unsigned int createTexture2D() {
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	stateCache->bindTexture(0, GL_TEXTURE_2D, texture);
+	// set the texture wrapping/filtering options (on currently bound texture)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return texture;
+}
+
+void uploadTexture2D(TextureUploader& uploader, unsigned int texture, DecodedImage& image) {
+	if (!image.pixels) {
+		std::cout << "Failed to load texture" << std::endl;
+		return;
+	}
+	// the uploader keeps the pixels until they're in its ring and frees them then
+	uploader.queue(texture, GL_RGB, image.width, image.height, image.channels, image.pixels, stbi_image_free, image.mips.empty());
+	image.pixels = nullptr;
+	for (size_t i = 0; i < image.mips.size(); i++) {
+		const MipLevel& level = image.mips[i];
+		uploader.queueLevel(texture, (int)i + 1, GL_RGB, level.width, level.height, image.channels, level.pixels, freeMipPixels);
+	}
+	image.mips.clear();
+}
+
+// The cooked, block-compressed version when Tools/CookTextures has made one, otherwise the source image
+// decoded by the loader and streamed in by the uploader.
+unsigned int loadTexture2D(const char* cookedPath, const char* imagePath, TextureLoader& loader, TextureUploader& uploader) {
+	CompressedTextureInfo info;
+	unsigned int texture = loadCompressedTexture(cookedPath, *stateCache, &info);
+	if (texture) {
+		std::cout << "TEXTURE::COOKED " << cookedPath << " " << info.width << "x" << info.height << ", " << info.levels << " levels, "
+			<< info.bytes << " bytes in " << info.loadMs << " ms" << std::endl;
+		return texture;
+	}
+	texture = createTexture2D();
+	// the images are sRGB, so their mips are filtered in linear light, on the loader's workers
+	MipSettings mips;
+	mips.filter = MIP_FILTER_KAISER;
+	mips.srgb = true;
+	loader.request(imagePath, 0, true, [&uploader, texture](DecodedImage& image) {
+		uploadTexture2D(uploader, texture, image);
+	}, &mips);
+	return texture;
+}
+
 void processInput(GLFWwindow* window) {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) { // this function returns GLFW_RELEASE if the key is not pressed
 		glfwSetWindowShouldClose(window, true);
@@ -55,12 +130,15 @@ void processInput(GLFWwindow* window) {
 	if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS) {
 		isWireFrame = !isWireFrame;
 		if (isWireFrame) {
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			stateCache->polygonModeFrontAndBack(GL_FILL);
 		}
 		else {
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+			stateCache->polygonModeFrontAndBack(GL_LINE);
 		}
 	}
+	if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) {
+		renderMode = (RenderMode)((renderMode + 1) % RENDER_MODE_COUNT);
+	}
 	if (glfwGetKey(window, GLFW_KEY_W)) {
 		camera->ProcessKeyboard(Camera_Movement::FORWARD, deltaTime);
 	}
@@ -97,15 +175,65 @@ int main() {
 	}
 	// openGL functions can now be used beyond this point:
 	glViewport(0, 0, 800, 600);
+	loadGLExtensions();
 
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+
+	// every bind, setup included, goes through the state cache so unchanged state never reaches the
+	// driver and its shadow never goes stale
+	stateCache = new GLStateCache();
 	
 	int nrAttributes;
 	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
 	std::cout << "Maximum nr of vertex attributes supported: " << nrAttributes << std::endl;
 
 	ShaderLoader* shaderLoader = new ShaderLoader();
-	unsigned int shaderProgram = shaderLoader->createShaderProgram("Shaders/Vertex/learningVertexShader.v", "Shaders/Fragment/learningFragmentShader.f");
+	ProgramBinaryCache programCache;
+	programCache.init();
+	shaderLoader->setProgramCache(&programCache);
+	shaderLoader->setStateCache(stateCache);
+	shaderLoader->trackDriverRecompiles();
+	// sampler units are set as soon as a program has linked; names a program doesn't use are ignored
+	shaderLoader->setProgramReadyCallback([shaderLoader](unsigned int program) {
+		shaderLoader->use(program);
+		shaderLoader->setInt("texture1", 0); //set which GL_TEXTUREX this texture is associated with
+		shaderLoader->setInt("texture2", 1);
+		shaderLoader->setInt("textures", 0);
+		shaderLoader->flushUniforms();
+	});
+	// textures are read and decoded on worker threads while the shaders compile and the meshes are set
+	// up; only the uploads wait for the GL thread, and go through pixel buffers within a per-frame budget
+	TextureLoader textureLoader;
+	textureLoader.start();
+	TextureUploader textureUploader;
+	textureUploader.setStateCache(stateCache);
+	textureUploader.create(16 * 1024 * 1024, 4 * 1024 * 1024);
+	unsigned int texture1 = loadTexture2D("Textures/container.ktx2", "Textures/container.jpg", textureLoader, textureUploader);
+	unsigned int texture2 = loadTexture2D("Textures/awesomeface.ktx2", "Textures/awesomeface.png", textureLoader, textureUploader);
+
+	// the same images as layers of one texture array, so cubes with different textures can share a draw
+	TextureArrayManager textureArrays;
+	const char* arrayTexturePaths[] = { "Textures/container.jpg", "Textures/awesomeface.png", "Textures/wall.jpg" };
+	TextureLayer arrayLayers[3] = {};
+	for (int i = 0; i < 3; i++) {
+		textureLoader.request(arrayTexturePaths[i], 4, true, [&textureArrays, &arrayLayers, i](DecodedImage& image) {
+			if (image.pixels) {
+				arrayLayers[i] = textureArrays.add(image.pixels, image.width, image.height, 4);
+			}
+			else {
+				std::cout << "Failed to load texture" << std::endl;
+			}
+		});
+	}
+
+	// the fallbacks are tiny and built up front; the real programs compile while the textures load.
+	// INSTANCED takes the model matrix from the per-instance attributes instead of the uniform
+	unsigned long long instancedDefine = shaderLoader->defineBit("INSTANCED");
+	unsigned int fallbackProgram = shaderLoader->createShaderProgram("Shaders/Vertex/learningVertexShader.v", "Shaders/Fragment/fallbackFragmentShader.f");
+	unsigned int instancedFallbackProgram = shaderLoader->createShaderProgram("Shaders/Vertex/learningVertexShader.v", "Shaders/Fragment/fallbackFragmentShader.f", instancedDefine);
+	unsigned int shaderProgram = shaderLoader->createShaderProgramAsync("Shaders/Vertex/learningVertexShader.v", "Shaders/Fragment/learningFragmentShader.f", fallbackProgram);
+	unsigned int instancedProgram = shaderLoader->createShaderProgramAsync("Shaders/Vertex/learningVertexShader.v", "Shaders/Fragment/learningFragmentShader.f", instancedFallbackProgram, instancedDefine);
+	unsigned int textureArrayProgram = shaderLoader->createShaderProgramAsync("Shaders/Vertex/textureArrayVertexShader.v", "Shaders/Fragment/textureArrayFragmentShader.f", instancedFallbackProgram);
 
 	float vertices[]{
 		-0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
@@ -164,14 +292,23 @@ int main() {
 		glm::vec3(-1.3f, 1.0f, -1.5f),
 	};
 
+	// weld the 36 duplicated corners into shared vertices and order the triangles for the vertex cache
+	IndexedMesh cube = processMesh("CUBE", vertices, 36, 5);
+	int cubeIndexCount = (int)cube.indices.size();
+
 	unsigned int VAO1; // This stores vertexAttribute calls 
 	glGenVertexArrays(1, &VAO1);
-	glBindVertexArray(VAO1);
+	stateCache->bindVertexArray(VAO1);
 
 	unsigned int VBO1; // This stores vertex information
 	glGenBuffers(1, &VBO1);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO1);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	stateCache->bindBuffer(GL_ARRAY_BUFFER, VBO1);
+	glBufferData(GL_ARRAY_BUFFER, cube.vertices.size() * sizeof(float), cube.vertices.data(), GL_STATIC_DRAW);
+
+	unsigned int EBO1; // the element buffer binding is recorded in the VAO
+	glGenBuffers(1, &EBO1);
+	stateCache->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO1);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, cube.indices.size() * sizeof(unsigned int), cube.indices.data(), GL_STATIC_DRAW);
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0); // vertexAttribute pointers can only be initialized after a VBO is defined
 	glEnableVertexAttribArray(0);
@@ -182,57 +319,130 @@ int main() {
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(2);
 
-	stbi_set_flip_vertically_on_load(true);
-
-	unsigned int texture1;
-	glGenTextures(1, &texture1);
-
-	glBindTexture(GL_TEXTURE_2D, texture1);
-	// set the texture wrapping/filtering options (on currently bound texture)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load and generate the texture
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load("Textures/container.jpg", &width, &height, &nrChannels, 0);
-	if (data) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+	// per-instance model matrices for the instanced path, attribute locations 3-6
+	InstanceBuffer cubeInstances;
+	cubeInstances.create(*stateCache, VAO1, 3);
+	shaderLoader->registerVertexArray("CUBE", VAO1, { shaderProgram, instancedProgram });
+
+	// the same cube for the GPU-culled path, with the instance attributes fed by the culler's output
+	GpuCuller gpuCuller;
+	bool gpuCulling = gpuCuller.create(*shaderLoader);
+	unsigned int gpuCullVAO = 0;
+	if (gpuCulling) {
+		glGenVertexArrays(1, &gpuCullVAO);
+		stateCache->bindVertexArray(gpuCullVAO);
+		stateCache->bindBuffer(GL_ARRAY_BUFFER, VBO1);
+		stateCache->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO1);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		gpuCuller.attach(*stateCache, gpuCullVAO, 3);
+		gpuCuller.setMesh(cubeIndexCount);
+		shaderLoader->registerVertexArray("GPU_CULL", gpuCullVAO, { instancedProgram });
 	}
 	else {
-		std::cout << "Failed to load texture" << std::endl;
+		std::cout << "GPU_CULLING::UNAVAILABLE, the GPU culled mode culls on the CPU" << std::endl;
 	}
 
-	unsigned int texture2;
-	glGenTextures(1, &texture2);
+	// the startup images are all queued before the first frame; the loader keeps running for later ones
+	textureLoader.finish();
+	textureLoader.getStats().print("STARTUP", textureLoader.getWorkerCount());
+	textureArrays.build(*stateCache);
 
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	// set the texture wrapping/filtering options (on currently bound texture)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load and generate the texture
-	
-	data = stbi_load("Textures/awesomeface.png", &width, &height, &nrChannels, 0);
-	if (data) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else {
-		std::cout << "Failed to load texture" << std::endl;
+	//std::cout << glGetError() << std::endl;
+	int pendingShaderPrograms = shaderLoader->pollShaderPrograms();
+	std::cout << "SHADER::ASYNC " << pendingShaderPrograms << " programs still compiling after texture loading" << std::endl;
+	bool shaderStartupReported = pendingShaderPrograms == 0;
+	if (shaderStartupReported) {
+		programCache.getStats().print("STARTUP");
+		shaderLoader->printBuildReport("STARTUP");
 	}
 
-	stbi_image_free(data);
-
-
-	//std::cout << glGetError() << std::endl;
-	shaderLoader->use();
-	shaderLoader->setInt("texture1", 0); //set which GL_TEXTUREX this texture is associated with
-	shaderLoader->setInt("texture2", 1);
+	// saving a shader file recompiles the programs using it while the scene keeps running; builds with
+	// the shaders embedded have no files to watch
+	ShaderWatcher shaderWatcher;
+#ifndef EMBEDDED_SHADERS
+	shaderWatcher.start(shaderLoader->getShaderFiles());
+#endif
+	std::vector<ShaderFileChange> shaderChanges;
+
+#ifdef RUN_BENCHMARKS
+	shaderLoader->finishShaderPrograms();
+	runInstancingBenchmark(VAO1, cubeInstances, shaderProgram, instancedProgram, *stateCache);
+#endif
+
+	// the cubes don't move, so their model matrices only need to be built once
+	glm::mat4 cubeModels[10];
+	for (unsigned int i = 0; i < 10; i++) {
+		cubeModels[i] = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+		cubeModels[i] = glm::rotate(cubeModels[i], 20.0f * i, glm::vec3(1.0f, 0.3f, 0.5f));
+	}
 
-	glEnable(GL_DEPTH_TEST);
+	// view/projection are shared by every program through this buffer instead of per-program uniforms
+	FrameConstantsBuffer frameConstants;
+	frameConstants.setStateCache(stateCache);
+	frameConstants.create();
+
+	// per-frame instance and uniform data is written into a fenced ring instead of re-specified buffers
+	StreamBuffer streamBuffer;
+	streamBuffer.setStateCache(stateCache);
+	streamBuffer.create(1024 * 1024);
+
+	stateCache->setDepthTest(true);
+
+#ifdef RUN_BENCHMARKS
+	runRenderQueueBenchmark(VAO1, cubeInstances, instancedProgram, texture1, texture2, *stateCache);
+#endif
+
+	// the instanced path records the cubes into the queue, which sorts them and merges them into instanced draws
+	RenderQueue renderQueue;
+	renderQueue.setStreamBuffer(&streamBuffer);
+	renderQueue.setShaderLoader(shaderLoader);
+	RenderMaterial cubeMaterial;
+	cubeMaterial.textures[0] = texture1;
+	cubeMaterial.textures[1] = texture2;
+	cubeMaterial.textureCount = 2;
+	DrawItem cubeItem = { instancedProgram, VAO1, renderQueue.addMaterial(cubeMaterial), GL_TRIANGLES, 0, cubeIndexCount, UniformCache::INVALID_HANDLE, &cubeInstances, true };
+
+	// the same cube in a shared batch, drawn through indirect commands
+	MeshBatch meshBatch;
+	unsigned int cubeMesh = meshBatch.addMesh(cube.vertices.data(), (unsigned int)cube.vertexCount(), cube.indices.data(), (unsigned int)cube.indices.size());
+	meshBatch.finalize(*stateCache);
+	shaderLoader->registerVertexArray("MESH_BATCH", meshBatch.getVAO(), { textureArrayProgram });
+
+	// alternate container and wall as the base texture, the face on top of both; all from the one array
+	unsigned int cubeTextureArray = textureArrays.getTexture(arrayLayers[0].array);
+	glm::vec2 cubeLayers[10];
+	for (unsigned int i = 0; i < 10; i++) {
+		float baseLayer = (float)(i % 2 ? arrayLayers[2].layer : arrayLayers[0].layer);
+		cubeLayers[i] = glm::vec2(baseLayer, (float)arrayLayers[1].layer);
+	}
+	std::vector<glm::vec2> visibleLayers;
+
+#ifdef RUN_BENCHMARKS
+	runMultiDrawBenchmark(instancedProgram, *stateCache);
+	runFrustumCullingBenchmark();
+	runGpuCullingBenchmark(*shaderLoader);
+	runTextureLoadingBenchmark();
+	runTextureStreamingBenchmark();
+	runMipGenerationBenchmark();
+	runJpegDecodingBenchmark();
+	// the texture benchmarks bind their scratch textures behind the cache's back
+	stateCache->invalidate();
+#endif
+
+	// a unit cube rotated any way fits in a sphere of radius sqrt(3)/2 around its center
+	BoundingSpheres cubeBounds;
+	for (unsigned int i = 0; i < 10; i++) {
+		cubeBounds.add(cubePositions[i], 0.8660254f);
+	}
+	if (gpuCulling) {
+		gpuCuller.setInstances(cubeBounds, cubeModels);
+	}
+	FrustumCuller frustumCuller;
+	std::vector<unsigned int> visibleCubes;
+	std::vector<glm::mat4> visibleModels;
 
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
@@ -246,6 +456,25 @@ int main() {
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		stateCache->beginFrame();
+
+		// resubmit programs whose files changed; programs that finished compiling since the last frame
+		// replace their fallbacks or the versions they were reloaded from
+		shaderChanges.clear();
+		shaderWatcher.takeChanges(shaderChanges);
+		for (const ShaderFileChange& change : shaderChanges) {
+			shaderLoader->reloadShaderFile(change.path, change.code, change.detected);
+		}
+		pendingShaderPrograms = shaderLoader->pollShaderPrograms();
+		if (!shaderStartupReported && pendingShaderPrograms == 0) {
+			programCache.getStats().print("STARTUP");
+			shaderLoader->printBuildReport("STARTUP");
+			shaderStartupReported = true;
+		}
+		// images decoded since the last frame are queued, and queued ones stream in within the budget
+		textureLoader.upload();
+		textureUploader.update();
+
 		// input
 		processInput(window);
 
@@ -263,40 +492,98 @@ int main() {
 		glm::mat4 projection;
 		projection = glm::perspective(glm::radians(camera->Zoom), 800.0f / 600.0f, 0.1f, 100.0f);
 
-		int viewLoc = glGetUniformLocation(shaderProgram, "view");
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-		int projLoc = glGetUniformLocation(shaderProgram, "projection");
-		glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-		
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-		//EBO method:
-		glBindVertexArray(VAO1);
+		frameConstants.update(streamBuffer, view, projection, camera->Position, currentFrame);
 
-		for (unsigned int i = 0; i < 10; i++) {
-			glm::mat4 model = glm::mat4(1.0f);
-			
-			model = glm::translate(model, cubePositions[i]);
+		// only cubes whose bounds touch the view frustum are submitted
+		Frustum frustum = Frustum::fromViewProjection(projection * view);
+		frustumCuller.cull(frustum, cubeBounds, visibleCubes);
 
-			float angle = 20.0f * i;
-			
-			model = glm::rotate(model, angle, glm::vec3(1.0f, 0.3f, 0.5f));
-
-			int modelLoc = glGetUniformLocation(shaderProgram, "model");
-			glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		if (renderMode == RENDER_GPU_CULLED && gpuCulling) {
+			// the CPU result above isn't used here; the compute pass culls the same spheres on its own
+			gpuCuller.cull(frustum);
+			shaderLoader->use(shaderLoader->resolve(instancedProgram));
+			stateCache->bindTexture(0, GL_TEXTURE_2D, texture1);
+			stateCache->bindTexture(1, GL_TEXTURE_2D, texture2);
+			stateCache->bindVertexArray(gpuCullVAO);
+			gpuCuller.draw(GL_TRIANGLES);
+		}
+		else if (renderMode == RENDER_MULTI_DRAW) {
+			shaderLoader->use(shaderLoader->resolve(textureArrayProgram));
+			stateCache->bindTexture(0, GL_TEXTURE_2D_ARRAY, cubeTextureArray);
+			visibleModels.clear();
+			visibleLayers.clear();
+			for (unsigned int i : visibleCubes) {
+				visibleModels.push_back(cubeModels[i]);
+				visibleLayers.push_back(cubeLayers[i]);
+			}
+			meshBatch.clear();
+			if (!visibleModels.empty()) {
+				meshBatch.add(cubeMesh, visibleModels.data(), (unsigned int)visibleModels.size(), visibleLayers.data());
+			}
+			meshBatch.submit(*stateCache);
+		}
+		else if (renderMode == RENDER_QUEUE) {
+			renderQueue.clear();
+			cubeItem.program = shaderLoader->resolve(instancedProgram);
+			for (unsigned int i : visibleCubes) {
+				renderQueue.push(PASS_OPAQUE, glm::length(cubePositions[i] - camera->Position), cubeItem, cubeModels[i]);
+			}
+			renderQueue.sort();
+			renderQueue.submit(*stateCache);
+		}
+		else {
+			shaderLoader->use(shaderLoader->resolve(shaderProgram));
+			// a lookup in the loader's uniform cache, since the fallback has its own handles
+			int modelHandle = shaderLoader->getUniformHandle("model");
+			stateCache->bindTexture(0, GL_TEXTURE_2D, texture1);
+			stateCache->bindTexture(1, GL_TEXTURE_2D, texture2);
+			//EBO method:
+			stateCache->bindVertexArray(VAO1);
+
+			for (unsigned int i : visibleCubes) {
+				glm::mat4 model = glm::mat4(1.0f);
+				
+				model = glm::translate(model, cubePositions[i]);
+
+				float angle = 20.0f * i;
+				
+				model = glm::rotate(model, angle, glm::vec3(1.0f, 0.3f, 0.5f));
+
+				shaderLoader->setUniform(modelHandle, model);
+				shaderLoader->flushUniforms();
+
+				glDrawElements(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0);
+			}
 		}
 
-		glBindVertexArray(0);
+		streamBuffer.endFrame();
 
 		// check and call events and swap the buffers
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
+	stateCache->getFrameStats().print("LAST_FRAME");
+	const CullStats& cullStats = frustumCuller.getLastStats();
+	std::cout << "CULLING::LAST_FRAME " << cullStats.visible << " visible, " << cullStats.culled << " culled, "
+		<< cullStats.milliseconds << " ms" << std::endl;
+	if (gpuCulling && renderMode == RENDER_GPU_CULLED) {
+		// the last frame's GPU result against the CPU culler's, for the same frustum
+		std::vector<unsigned int> gpuVisible;
+		gpuCuller.readVisible(gpuVisible);
+		std::cout << "GPU_CULLING::LAST_FRAME " << gpuVisible.size() << " visible, " << gpuCuller.getLastSubmitMs() << " ms to submit, "
+			<< (gpuVisible == visibleCubes ? "matches the CPU culler" : "MISMATCH against the CPU culler") << std::endl;
+	}
+	const StreamBufferStats& streamStats = streamBuffer.getFrameStats();
+	std::cout << "STREAM_BUFFER::LAST_FRAME " << streamStats.bytesStreamed << " bytes, " << streamStats.stalls << " stalls, "
+		<< streamStats.orphans << " orphans" << (streamBuffer.isPersistent() ? " (persistent)" : "") << std::endl;
+	shaderLoader->getReloadStats().print("RELOAD_TOTAL");
+	shaderLoader->getUniformStats().print("TOTAL");
+	shaderLoader->printRegistryStats("REGISTRY");
+	shaderLoader->getBuildLog().getStats().print("TOTAL");
+	textureUploader.getStats().print("TOTAL");
+	textureLoader.stop();
+	textureUploader.destroy();
+	shaderWatcher.stop();
 	glfwTerminate(); // this function properly cleans up / deletes all of GLFW's resources that were allocated.
 	return 0;
 }
\ No newline at end of file
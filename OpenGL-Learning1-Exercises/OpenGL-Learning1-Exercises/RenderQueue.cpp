@@ -0,0 +1,167 @@
+#include "RenderQueue.h"
+#include <chrono>
+
+#include "Timing.h"
+
+static const int RADIX_BITS = 11;
+static const int RADIX_BUCKETS = 1 << RADIX_BITS;
+static const int RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+
+uint64_t RenderQueue::makeKey(RenderPass pass, unsigned int program, unsigned int material, unsigned int vao, float depth) {
+	uint64_t quantizedDepth = (uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * 16777215.0f);
+	uint64_t state = ((uint64_t)(program & 0xFF) << 22) | ((uint64_t)(material & 0xFFF) << 10) | (uint64_t)(vao & 0x3FF);
+	if (pass == PASS_TRANSPARENT) {
+		return ((uint64_t)pass << 60) | ((0xFFFFFFull - quantizedDepth) << 30) | state;
+	}
+	return ((uint64_t)pass << 60) | (state << 24) | quantizedDepth;
+}
+
+unsigned int RenderQueue::addMaterial(const RenderMaterial& material) {
+	materials.push_back(material);
+	return (unsigned int)materials.size() - 1;
+}
+
+void RenderQueue::reserve(size_t itemCount) {
+	items.reserve(itemCount);
+	models.reserve(itemCount);
+	sortEntries.reserve(itemCount);
+	sortScratch.reserve(itemCount);
+	batchModels.reserve(itemCount);
+}
+
+void RenderQueue::clear() {
+	items.clear();
+	models.clear();
+	sortEntries.clear();
+}
+
+void RenderQueue::push(RenderPass pass, float depth, const DrawItem& item, const glm::mat4& model) {
+	SortEntry entry;
+	entry.key = makeKey(pass, item.program, item.material, item.vao, depth / farPlane);
+	entry.item = (unsigned int)items.size();
+	sortEntries.push_back(entry);
+	items.push_back(item);
+	models.push_back(model);
+}
+
+void RenderQueue::sort() {
+	auto start = std::chrono::steady_clock::now();
+	size_t count = sortEntries.size();
+	sortScratch.resize(count);
+
+	// one pass over the keys builds the histograms of every digit
+	histograms.assign(RADIX_PASSES * RADIX_BUCKETS, 0);
+	for (size_t i = 0; i < count; i++) {
+		uint64_t key = sortEntries[i].key;
+		for (int pass = 0; pass < RADIX_PASSES; pass++) {
+			histograms[pass * RADIX_BUCKETS + ((key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+		}
+	}
+
+	SortEntry* source = sortEntries.data();
+	SortEntry* destination = sortScratch.data();
+	for (int pass = 0; pass < RADIX_PASSES; pass++) {
+		unsigned int* histogram = &histograms[pass * RADIX_BUCKETS];
+		int shift = pass * RADIX_BITS;
+
+		// a digit that is the same for every key (unused key bits, a single program...) can't reorder anything
+		if (count == 0 || histogram[(source[0].key >> shift) & (RADIX_BUCKETS - 1)] == count) {
+			continue;
+		}
+
+		unsigned int offset = 0;
+		for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+			unsigned int bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+		for (size_t i = 0; i < count; i++) {
+			destination[histogram[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+		}
+		std::swap(source, destination);
+	}
+	if (source != sortEntries.data()) {
+		sortEntries.swap(sortScratch);
+	}
+	lastSortMs = elapsedMs(start);
+}
+
+void RenderQueue::flushBatch(GLStateCache& stateCache, const DrawItem& item) {
+	if (batchModels.empty()) {
+		return;
+	}
+	// the batch's VAO is still bound from the first item of the run
+	auto start = std::chrono::steady_clock::now();
+	if (streamBuffer) {
+		item.instances->stream(stateCache, *streamBuffer, batchModels.data(), (int)batchModels.size());
+	}
+	else {
+		item.instances->upload(stateCache, batchModels.data(), (int)batchModels.size());
+	}
+	lastUploadMs += elapsedMs(start);
+	lastUploadBytes += batchModels.size() * sizeof(glm::mat4);
+	if (item.indexed) {
+		item.instances->drawElements(item.mode, item.count, GL_UNSIGNED_INT, (void*)(item.first * sizeof(unsigned int)));
+	}
+	else {
+		item.instances->drawArrays(item.mode, item.first, item.count);
+	}
+	batchModels.clear();
+	lastDrawCalls++;
+}
+
+void RenderQueue::submit(GLStateCache& stateCache) {
+	auto start = std::chrono::steady_clock::now();
+	lastDrawCalls = 0;
+	lastUploadMs = 0.0;
+	lastUploadBytes = 0;
+
+	const DrawItem* batch = nullptr;
+	for (size_t i = 0; i < sortEntries.size(); i++) {
+		const DrawItem& item = items[sortEntries[i].item];
+
+		bool extendsBatch = batch && item.instances == batch->instances && item.program == batch->program
+			&& item.vao == batch->vao && item.material == batch->material && item.mode == batch->mode
+			&& item.first == batch->first && item.count == batch->count && item.indexed == batch->indexed;
+		if (extendsBatch) {
+			batchModels.push_back(models[sortEntries[i].item]);
+			continue;
+		}
+		if (batch) {
+			flushBatch(stateCache, *batch);
+			batch = nullptr;
+		}
+
+		if (shaderLoader) {
+			shaderLoader->use(item.program);
+		}
+		else {
+			stateCache.useProgram(item.program);
+		}
+		const RenderMaterial& material = materials[item.material];
+		for (int unit = 0; unit < material.textureCount; unit++) {
+			stateCache.bindTexture(unit, material.target, material.textures[unit]);
+		}
+		stateCache.bindVertexArray(item.vao);
+
+		if (item.instances) {
+			batch = &item;
+			batchModels.push_back(models[sortEntries[i].item]);
+		}
+		else {
+			shaderLoader->setUniform(item.modelHandle, models[sortEntries[i].item]);
+			shaderLoader->flushUniforms();
+			if (item.indexed) {
+				glDrawElements(item.mode, item.count, GL_UNSIGNED_INT, (void*)(item.first * sizeof(unsigned int)));
+			}
+			else {
+				glDrawArrays(item.mode, item.first, item.count);
+			}
+			lastDrawCalls++;
+		}
+	}
+	if (batch) {
+		flushBatch(stateCache, *batch);
+	}
+	lastSubmitMs = elapsedMs(start) - lastUploadMs;
+}
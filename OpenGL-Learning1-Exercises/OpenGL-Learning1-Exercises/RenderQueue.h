@@ -0,0 +1,103 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "StateCache.h"
+#include "InstanceBuffer.h"
+#include "Shaders.h"
+
+const int MAX_MATERIAL_TEXTURES = 4;
+// Per-frame CPU time allowed for sorting the queue and issuing its state changes and draws, without
+// the instance data upload (checked by the benchmark).
+const double RENDER_QUEUE_BUDGET_MS = 8.0;
+
+// Set of textures bound together, one per unit starting at GL_TEXTURE0.
+struct RenderMaterial {
+	GLenum target = GL_TEXTURE_2D;
+	unsigned int textures[MAX_MATERIAL_TEXTURES] = {};
+	int textureCount = 0;
+};
+
+enum RenderPass {
+	PASS_OPAQUE = 0,
+	PASS_TRANSPARENT = 1
+};
+
+// One recorded draw. Items that share program, material, VAO, vertex range and instance buffer
+// are merged into a single instanced draw when submitted; items without an instance buffer are
+// drawn one by one with their matrix set through modelHandle, a ShaderLoader uniform handle looked
+// up in program, so it goes through the program's uniform shadow. Indexed items read first/count as
+// a range of GL_UNSIGNED_INT indices in the VAO's element buffer.
+struct DrawItem {
+	unsigned int program;
+	unsigned int vao;
+	unsigned int material; // index returned by RenderQueue::addMaterial
+	GLenum mode;
+	int first;
+	int count;
+	int modelHandle; // only used when instances is null
+	InstanceBuffer* instances;
+	bool indexed;
+};
+
+// Per-frame draw list. Items go into a flat array and are ordered by a packed 64-bit key:
+//   opaque:      pass:4 | program:8 | material:12 | vao:10 | depth:24   (state first, then front to back)
+//   transparent: pass:4 | ~depth:24 | program:8 | material:12 | vao:10  (back to front)
+// The ids in the key are truncated to their field width; a collision only costs sort quality, the
+// item itself always holds the real GL names. Keys are sorted with an LSD radix sort.
+class RenderQueue {
+private:
+	struct SortEntry {
+		uint64_t key;
+		unsigned int item;
+	};
+
+	std::vector<DrawItem> items;
+	std::vector<glm::mat4> models;
+	std::vector<SortEntry> sortEntries;
+	std::vector<SortEntry> sortScratch;
+	std::vector<unsigned int> histograms;
+	std::vector<glm::mat4> batchModels;
+	std::vector<RenderMaterial> materials;
+
+	StreamBuffer* streamBuffer = nullptr;
+	ShaderLoader* shaderLoader = nullptr;
+	float farPlane = 100.0f;
+	double lastSortMs = 0.0;
+	double lastSubmitMs = 0.0;
+	double lastUploadMs = 0.0;
+	size_t lastUploadBytes = 0;
+	unsigned int lastDrawCalls = 0;
+
+	void flushBatch(GLStateCache& stateCache, const DrawItem& item);
+
+public:
+	static uint64_t makeKey(RenderPass pass, unsigned int program, unsigned int material, unsigned int vao, float depth);
+
+	unsigned int addMaterial(const RenderMaterial& material);
+	// Depth is the view-space distance, quantized against this far plane.
+	void setFarPlane(float distance) { farPlane = distance; }
+	void reserve(size_t itemCount);
+	// When set, batched instance matrices are streamed through this ring buffer instead of being
+	// re-uploaded into each InstanceBuffer's own storage.
+	void setStreamBuffer(StreamBuffer* buffer) { streamBuffer = buffer; }
+	// When set, programs are bound through the loader so its current program and uniform table follow
+	// the queue. Required for items without an instance buffer.
+	void setShaderLoader(ShaderLoader* loader) { shaderLoader = loader; }
+
+	void clear();
+	void push(RenderPass pass, float depth, const DrawItem& item, const glm::mat4& model);
+	void sort();
+	void submit(GLStateCache& stateCache);
+
+	size_t size() const { return items.size(); }
+	double getLastSortMs() const { return lastSortMs; }
+	// State changes and draw calls only; copying the batched matrices into instance buffers scales with
+	// the bytes moved rather than the item count and is reported on its own.
+	double getLastSubmitMs() const { return lastSubmitMs; }
+	double getLastUploadMs() const { return lastUploadMs; }
+	size_t getLastUploadBytes() const { return lastUploadBytes; }
+	unsigned int getLastDrawCalls() const { return lastDrawCalls; }
+};
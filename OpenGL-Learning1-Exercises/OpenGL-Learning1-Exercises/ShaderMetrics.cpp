@@ -0,0 +1,85 @@
+#include "ShaderMetrics.h"
+#include <algorithm>
+#include <iostream>
+
+void ShaderBuildStats::print(const char* label) const {
+	std::cout << "SHADER_BUILD::" << label << " " << programs << " programs, " << cacheHits << " from the cache, "
+		<< compiledStages << " stages compiled, " << failed << " failed, read " << readMs << " ms, compile " << compileMs
+		<< " ms, link " << linkMs << " ms, " << sourceBytes << " source bytes, " << infoLogBytes << " info log bytes, "
+		<< driverRecompiles << " driver recompiles" << std::endl;
+}
+
+int ShaderBuildLog::begin(const std::string& label, unsigned int program, int stageCount, double readMs) {
+	ProgramBuildMetrics build;
+	build.label = label;
+	build.program = program;
+	build.stageCount = stageCount;
+	build.readMs = readMs;
+	builds.push_back(build);
+	return (int)builds.size() - 1;
+}
+
+void ShaderBuildLog::finish(int index, bool linked, double wallMs) {
+	ProgramBuildMetrics& build = builds[index];
+	build.finished = true;
+	build.linked = linked;
+	build.wallMs = wallMs;
+
+	stats.programs++;
+	stats.cacheHits += build.cacheHit ? 1 : 0;
+	stats.failed += linked ? 0 : 1;
+	stats.readMs += build.readMs;
+	for (int stage = 0; stage < build.stageCount; stage++) {
+		stats.compiledStages += build.cacheHit || build.sharedStage[stage] ? 0 : 1;
+		stats.compileMs += build.compileMs[stage];
+	}
+	stats.linkMs += build.linkMs;
+	stats.sourceBytes += build.sourceBytes;
+	stats.infoLogBytes += build.infoLogBytes;
+}
+
+void ShaderBuildLog::addDriverRecompile(unsigned int program) {
+	stats.driverRecompiles++;
+	for (size_t i = builds.size(); i-- > 0;) {
+		if (builds[i].program == program) {
+			builds[i].driverRecompiles++;
+			return;
+		}
+	}
+}
+
+void ShaderBuildLog::printReport(const char* label, int slowest) const {
+	stats.print(label);
+
+	std::vector<const ProgramBuildMetrics*> finished;
+	for (const ProgramBuildMetrics& build : builds) {
+		if (build.finished) {
+			finished.push_back(&build);
+		}
+	}
+	std::sort(finished.begin(), finished.end(), [](const ProgramBuildMetrics* a, const ProgramBuildMetrics* b) {
+		return a->totalMs() > b->totalMs();
+	});
+	for (int i = 0; i < slowest && i < (int)finished.size(); i++) {
+		const ProgramBuildMetrics& build = *finished[i];
+		std::cout << "SHADER_BUILD::SLOWEST " << build.totalMs() << " ms " << build.label << " (program " << build.program
+			<< (build.replaces ? ", reload" : "") << (build.cacheHit ? ", cache hit" : ", cache miss")
+			<< (build.linked ? "" : ", failed") << "): read " << build.readMs << " ms, ";
+		if (build.cacheHit) {
+			std::cout << "binary load " << build.linkMs;
+		}
+		else {
+			std::cout << "compile";
+			for (int stage = 0; stage < build.stageCount; stage++) {
+				std::cout << (stage ? " + " : " ") << build.compileMs[stage] << (build.sharedStage[stage] ? " (shared)" : "");
+			}
+			std::cout << " ms, link " << build.linkMs;
+		}
+		std::cout << " ms, ready after " << build.wallMs << " ms, " << build.sourceBytes
+			<< " source bytes, " << build.infoLogBytes << " info log bytes";
+		if (build.driverRecompiles) {
+			std::cout << ", " << build.driverRecompiles << " driver recompiles";
+		}
+		std::cout << std::endl;
+	}
+}
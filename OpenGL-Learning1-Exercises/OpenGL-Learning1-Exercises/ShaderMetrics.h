@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// What building one program object cost, from reading its sources to its link status being known. A
+// hot reload builds a new object and gets its own entry. Times are CPU milliseconds on the render
+// thread: a driver that compiles on background threads does most of its work between submitting and
+// finishing, so the blocking part shows up in the status queries timed at finish and wallMs is the
+// better measure of how long the program took to become usable.
+struct ProgramBuildMetrics {
+	std::string label; // stage paths
+	unsigned int program = 0;
+	unsigned int replaces = 0; // the program a hot reload was built for, 0 otherwise
+	bool cacheHit = false;     // linked from the binary cache, no stages compiled
+	bool finished = false;
+	bool linked = false;
+	int stageCount = 0;
+	double readMs = 0.0;       // preprocessing: reading files, resolving includes, hashing
+	double compileMs[2] = {};  // glShaderSource + glCompileShader, plus waiting for the compile status
+	bool sharedStage[2] = {};  // attached from another program, so nothing was compiled for it
+	double linkMs = 0.0;       // glLinkProgram, or glProgramBinary on a hit, plus waiting for the link status
+	double wallMs = 0.0;       // from the first file read to the link status, background compiling included
+	size_t sourceBytes = 0;    // preprocessed text handed to the driver
+	int infoLogBytes = 0;      // shader and program info logs; non-empty on success means warnings
+	unsigned int driverRecompiles = 0; // performance messages about recompiling it while it was in use
+
+	double totalMs() const { return readMs + compileMs[0] + compileMs[1] + linkMs; }
+};
+
+struct ShaderBuildStats {
+	unsigned int programs = 0;
+	unsigned int cacheHits = 0;
+	unsigned int compiledStages = 0;
+	unsigned int failed = 0;
+	double readMs = 0.0;
+	double compileMs = 0.0;
+	double linkMs = 0.0;
+	size_t sourceBytes = 0;
+	int infoLogBytes = 0;
+	unsigned int driverRecompiles = 0;
+
+	void print(const char* label) const;
+};
+
+// Every program build ShaderLoader has done, in submission order, with running totals.
+class ShaderBuildLog {
+private:
+	std::vector<ProgramBuildMetrics> builds;
+	ShaderBuildStats stats;
+
+public:
+	// Returns the index the build is updated through until finish() is called for it.
+	int begin(const std::string& label, unsigned int program, int stageCount, double readMs);
+	ProgramBuildMetrics& get(int index) { return builds[index]; }
+	void finish(int index, bool linked, double wallMs);
+	// Charged to the newest build of program, the one the driver is drawing with.
+	void addDriverRecompile(unsigned int program);
+
+	const std::vector<ProgramBuildMetrics>& getBuilds() const { return builds; }
+	const ShaderBuildStats& getStats() const { return stats; }
+	// The totals followed by the slowest finished builds, most expensive first.
+	void printReport(const char* label, int slowest) const;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Turns backslashes into '/' and collapses "." and "dir/../", so one file reached along different
+// relative paths is recognised as one. Shared by the preprocessor and Tools/EmbedShaders, whose stored
+// paths have to compare equal to the ones the preprocessor looks up.
+inline std::string normalizePath(const std::string& path) {
+	std::string slashed = path;
+	for (char& c : slashed) {
+		if (c == '\\') {
+			c = '/';
+		}
+	}
+	std::vector<std::string> parts;
+	std::stringstream stream(slashed);
+	std::string part;
+	while (std::getline(stream, part, '/')) {
+		if (part == "..") {
+			if (!parts.empty() && parts.back() != "..") {
+				parts.pop_back();
+			}
+			else {
+				parts.push_back(part);
+			}
+		}
+		else if (!part.empty() && part != ".") {
+			parts.push_back(part);
+		}
+	}
+	std::string normalized;
+	for (size_t i = 0; i < parts.size(); i++) {
+		normalized += (i ? "/" : "") + parts[i];
+	}
+	return normalized;
+}
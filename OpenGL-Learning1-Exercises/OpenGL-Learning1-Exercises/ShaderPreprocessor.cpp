@@ -0,0 +1,179 @@
+#include "ShaderPreprocessor.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include "Hash.h"
+#include "MappedFile.h"
+#include "ShaderPath.h"
+#ifdef EMBEDDED_SHADERS
+#include "EmbeddedShaders.h"
+#endif
+
+void PreprocessedSource::clear() {
+	strings.clear();
+	lengths.clear();
+	generated.clear();
+	files.clear();
+	hash = FNV_OFFSET_BASIS;
+}
+
+void PreprocessedSource::addSegment(const char* data, size_t length) {
+	if (length > 0) {
+		strings.push_back(data);
+		lengths.push_back((int)length);
+	}
+}
+
+void PreprocessedSource::addGenerated(const std::string& text) {
+	generated.push_back(text);
+	addSegment(generated.back().data(), generated.back().size());
+}
+
+std::string PreprocessedSource::text() const {
+	std::string joined;
+	for (size_t i = 0; i < strings.size(); i++) {
+		joined.append(strings[i], lengths[i]);
+	}
+	return joined;
+}
+
+static std::string directoryOf(const std::string& path) {
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+unsigned long long ShaderPreprocessor::defineBit(const std::string& name) {
+	auto it = std::find(defineNames.begin(), defineNames.end(), name);
+	if (it != defineNames.end()) {
+		return 1ull << (it - defineNames.begin());
+	}
+	if (defineNames.size() == MAX_DEFINES) {
+		std::cout << "ERROR::SHADER_PREPROCESSOR::TOO_MANY_DEFINES " << name << std::endl;
+		return 0;
+	}
+	defineNames.push_back(name);
+	return 1ull << (defineNames.size() - 1);
+}
+
+void ShaderPreprocessor::updateFile(const std::string& path, const std::string& code) {
+	std::unique_ptr<SourceFile>& file = files[path];
+	file.reset(new SourceFile());
+	file->text = code;
+	file->data = file->text.data();
+	file->size = file->text.size();
+	file->hash = hashBytes(FNV_OFFSET_BASIS, file->data, file->size);
+}
+
+const ShaderPreprocessor::SourceFile* ShaderPreprocessor::loadFile(const std::string& path) {
+	auto it = files.find(path);
+	if (it != files.end()) {
+		return it->second.get();
+	}
+	std::unique_ptr<SourceFile> file(new SourceFile());
+#ifdef EMBEDDED_SHADERS
+	for (const EmbeddedShader& embedded : embeddedShaders) {
+		if (path == embedded.path) {
+			file->data = embedded.data;
+			file->size = embedded.size;
+			file->hash = embedded.hash;
+		}
+	}
+#else
+	// the text is copied out and the mapping closed right away: an open mapping keeps editors from
+	// saving over the file on Windows, and turns a save that truncates it into SIGBUS elsewhere
+	MappedFile mapping;
+	if (mapping.open(path.c_str())) {
+		file->text.assign(mapping.getData(), mapping.getSize());
+		file->data = file->text.data();
+		file->size = file->text.size();
+		file->hash = hashBytes(FNV_OFFSET_BASIS, file->data, file->size);
+	}
+#endif
+	if (!file->data) {
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+		return nullptr;
+	}
+	return (files[path] = std::move(file)).get();
+}
+
+bool ShaderPreprocessor::expand(const std::string& path, const std::string& defines, PreprocessedSource& out) {
+	const SourceFile* source = loadFile(path);
+	if (!source) {
+		return false;
+	}
+	int fileIndex = (int)out.files.size();
+	out.files.push_back(path);
+	out.hash = hashBytes(out.hash, &source->hash, sizeof(source->hash));
+
+	const char* data = source->data;
+	const char* end = data + source->size;
+	const char* segmentStart = data;
+	int lineNumber = 1;
+	bool ok = true;
+	bool definesInserted = fileIndex != 0 || defines.empty();
+	for (const char* line = data; line < end; lineNumber++) {
+		const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+		const char* next = lineEnd ? lineEnd + 1 : end;
+		const char* start = line;
+		while (start < next && (*start == ' ' || *start == '\t')) {
+			start++;
+		}
+
+		if (!definesInserted && next - start >= 8 && memcmp(start, "#version", 8) == 0) {
+			// #version has to stay the first statement, so the defines go right after it
+			out.addSegment(segmentStart, next - segmentStart);
+			if (!lineEnd) {
+				out.addGenerated("\n");
+			}
+			out.addGenerated(defines + "#line " + std::to_string(lineNumber + 1) + " 0\n");
+			segmentStart = next;
+			definesInserted = true;
+		}
+		else if (next - start >= 8 && memcmp(start, "#include", 8) == 0) {
+			out.addSegment(segmentStart, line - segmentStart);
+			segmentStart = next;
+
+			std::string directive(start, lineEnd ? lineEnd : end);
+			size_t open = directive.find('"');
+			size_t close = open == std::string::npos ? open : directive.find('"', open + 1);
+			if (close == std::string::npos) {
+				std::cout << "ERROR::SHADER_PREPROCESSOR::BAD_INCLUDE " << path << ":" << lineNumber << std::endl;
+				ok = false;
+			}
+			else {
+				std::string includePath = normalizePath(directoryOf(path) + directive.substr(open + 1, close - open - 1));
+				if (std::find(out.files.begin(), out.files.end(), includePath) == out.files.end()) {
+					out.addGenerated("#line 1 " + std::to_string(out.files.size()) + "\n");
+					ok = expand(includePath, defines, out) && ok;
+					// an included file without a trailing newline would run into the #line below
+					out.addGenerated("\n");
+				}
+			}
+			// back in this file, on the line after the #include
+			out.addGenerated("#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n");
+		}
+		line = next;
+	}
+	out.addSegment(segmentStart, end - segmentStart);
+	if (!definesInserted) {
+		// no #version, so the defines simply go first
+		out.generated.push_front(defines + "#line 1 0\n");
+		out.strings.insert(out.strings.begin(), out.generated.front().data());
+		out.lengths.insert(out.lengths.begin(), (int)out.generated.front().size());
+	}
+	return ok;
+}
+
+bool ShaderPreprocessor::process(const std::string& path, unsigned long long defineMask, PreprocessedSource& out) {
+	out.clear();
+	std::string defines;
+	for (size_t i = 0; i < defineNames.size(); i++) {
+		if (defineMask & (1ull << i)) {
+			defines += "#define " + defineNames[i] + " 1\n";
+		}
+	}
+	out.hash = hashBytes(out.hash, defines.data(), defines.size());
+	return expand(normalizePath(path), defines, out);
+}
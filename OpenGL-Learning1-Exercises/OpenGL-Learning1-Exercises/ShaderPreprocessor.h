@@ -0,0 +1,64 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A shader stage after #include resolution and #define injection, kept as a list of segments for
+// glShaderSource instead of one joined string. File text is referenced where the preprocessor's file
+// cache holds it (a copy of the file, embedded data or reloaded text); only the #line and #define lines
+// it inserts are stored here. The segments stay valid until the preprocessor's file cache changes,
+// so submit them right away. Not copyable, since segments point into generated.
+struct PreprocessedSource {
+	std::vector<const char*> strings;
+	std::vector<int> lengths;
+	std::deque<std::string> generated; // a deque so earlier entries never move
+	// every file the stage was built from, the stage file itself first; a file's position here is the
+	// source string number used in its #line directives, so "2:14" in a compile log means files[2]
+	std::vector<std::string> files;
+	// over the injected defines and the content hash of every file in include order
+	unsigned long long hash = 0;
+
+	PreprocessedSource() = default;
+	PreprocessedSource(const PreprocessedSource&) = delete;
+	PreprocessedSource& operator=(const PreprocessedSource&) = delete;
+
+	void clear();
+	void addSegment(const char* data, size_t length);
+	void addGenerated(const std::string& text);
+	std::string text() const;
+};
+
+// Turns shader files into compilable GLSL:
+//   #include "path" is replaced by the file's contents, with the path relative to the including file.
+//     Each file is included at most once per stage, which also stops include cycles.
+//   The defines selected by a bitmask are inserted right after #version as "#define NAME 1".
+// Files are read the first time they are used and their text stays cached, so permutations of one
+// file read it once. Hot reload replaces a file's cached text with what the watcher read.
+// Built with EMBEDDED_SHADERS, files are served from EmbeddedShaders.h (see Tools/EmbedShaders.cpp)
+// with their hashes precomputed, and nothing is read from disk.
+class ShaderPreprocessor {
+private:
+	static const int MAX_DEFINES = 64;
+
+	struct SourceFile {
+		std::string text; // empty for embedded files, whose data points into EmbeddedShaders.h
+		const char* data = nullptr;
+		size_t size = 0;
+		unsigned long long hash = 0;
+	};
+
+	std::unordered_map<std::string, std::unique_ptr<SourceFile>> files;
+	std::vector<std::string> defineNames; // bit i of a mask selects defineNames[i]
+
+	const SourceFile* loadFile(const std::string& path);
+	bool expand(const std::string& path, const std::string& defines, PreprocessedSource& out);
+
+public:
+	// Returns the mask bit for name, registering it on first use.
+	unsigned long long defineBit(const std::string& name);
+
+	bool process(const std::string& path, unsigned long long defineMask, PreprocessedSource& out);
+	void updateFile(const std::string& path, const std::string& code);
+};
@@ -0,0 +1,133 @@
+#include "ShaderReflection.h"
+#include <iostream>
+
+int attributeLocations(GLenum type) {
+	switch (type) {
+	case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4:
+		return 2;
+	case GL_FLOAT_MAT3: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4:
+		return 3;
+	case GL_FLOAT_MAT4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+bool isIntegerAttribute(GLenum type) {
+	switch (type) {
+	case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+	case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void ProgramReflection::build(unsigned int shaderProgram) {
+	attributes.clear();
+	blocks.clear();
+	attributeMask = 0;
+
+	int attributeCount = 0;
+	int maxNameLength = 0;
+	glGetProgramiv(shaderProgram, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+	glGetProgramiv(shaderProgram, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
+	std::vector<char> nameBuffer(maxNameLength + 1);
+	for (int i = 0; i < attributeCount; i++) {
+		AttributeInfo info;
+		int nameLength = 0;
+		glGetActiveAttrib(shaderProgram, i, (int)nameBuffer.size(), &nameLength, &info.size, &info.type, nameBuffer.data());
+		info.name.assign(nameBuffer.data(), nameLength);
+		// built-ins like gl_VertexID are active but have no location
+		info.location = glGetAttribLocation(shaderProgram, info.name.c_str());
+		if (info.location < 0) {
+			continue;
+		}
+		info.locationCount = attributeLocations(info.type) * info.size;
+		for (int l = 0; l < info.locationCount && info.location + l < MASKED_ATTRIBUTE_LOCATIONS; l++) {
+			attributeMask |= 1u << (info.location + l);
+		}
+		attributes.push_back(info);
+	}
+
+	int blockCount = 0;
+	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+	nameBuffer.resize(maxNameLength + 1);
+	for (int i = 0; i < blockCount; i++) {
+		UniformBlockInfo info;
+		int nameLength = 0;
+		glGetActiveUniformBlockName(shaderProgram, i, (int)nameBuffer.size(), &nameLength, nameBuffer.data());
+		info.name.assign(nameBuffer.data(), nameLength);
+		info.index = i;
+		glGetActiveUniformBlockiv(shaderProgram, i, GL_UNIFORM_BLOCK_DATA_SIZE, &info.dataSize);
+		glGetActiveUniformBlockiv(shaderProgram, i, GL_UNIFORM_BLOCK_BINDING, &info.binding);
+		blocks.push_back(info);
+	}
+}
+
+const AttributeInfo* ProgramReflection::findAttribute(int location) const {
+	for (const AttributeInfo& attribute : attributes) {
+		if (location >= attribute.location && location < attribute.location + attribute.locationCount) {
+			return &attribute;
+		}
+	}
+	return nullptr;
+}
+
+const UniformBlockInfo* ProgramReflection::findBlock(const char* name) const {
+	for (const UniformBlockInfo& block : blocks) {
+		if (block.name == name) {
+			return &block;
+		}
+	}
+	return nullptr;
+}
+
+bool validateVertexLayout(const char* label, unsigned int enabledMask, const ProgramReflection* const* programs, int programCount) {
+	unsigned int readMask = 0;
+	for (int p = 0; p < programCount; p++) {
+		readMask |= programs[p]->attributeMask;
+	}
+
+	bool valid = true;
+	std::string read;
+	std::string stripped;
+	for (int location = 0; location < MASKED_ATTRIBUTE_LOCATIONS; location++) {
+		unsigned int bit = 1u << location;
+		if (!(readMask & bit)) {
+			if (enabledMask & bit) {
+				// nothing drawn with this VAO reads it; a disabled array is never fetched
+				glDisableVertexAttribArray(location);
+				stripped += " " + std::to_string(location);
+			}
+			continue;
+		}
+		read += " " + std::to_string(location);
+
+		const AttributeInfo* attribute = nullptr;
+		for (int p = 0; p < programCount && !attribute; p++) {
+			attribute = programs[p]->findAttribute(location);
+		}
+		if (!(enabledMask & bit)) {
+			std::cout << "ERROR::VERTEX_LAYOUT::" << label << " " << attribute->name << " at location " << location
+				<< " is read but has no enabled array" << std::endl;
+			valid = false;
+			continue;
+		}
+		glEnableVertexAttribArray(location);
+
+		// fewer components than the input has is fine (missing ones read as 0, 0, 0, 1), but an integer
+		// input fed from a float array or the other way round reads garbage
+		int integer = 0;
+		glGetVertexAttribiv(location, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+		if ((integer != 0) != isIntegerAttribute(attribute->type)) {
+			std::cout << "ERROR::VERTEX_LAYOUT::" << label << " " << attribute->name << " at location " << location
+				<< " is " << (integer ? "a float input fed from an integer array" : "an integer input fed from a float array") << std::endl;
+			valid = false;
+		}
+	}
+	std::cout << "VERTEX_LAYOUT::" << label << " reads" << read << (stripped.empty() ? "" : ", stripped" + stripped) << std::endl;
+	return valid;
+}
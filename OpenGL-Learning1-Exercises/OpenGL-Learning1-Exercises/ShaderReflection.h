@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+struct AttributeInfo {
+	std::string name;
+	int location;
+	GLenum type;
+	int size;          // array length, 1 for non-arrays
+	int locationCount; // matrices and arrays take several consecutive locations
+};
+
+struct UniformBlockInfo {
+	std::string name;
+	unsigned int index;
+	int dataSize;
+	int binding;
+};
+
+// Vertex attribute locations that fit in the 32-bit masks below. Drivers may expose more; locations
+// past these are left out of the masks and so never validated or stripped.
+const int MASKED_ATTRIBUTE_LOCATIONS = 32;
+
+// What a linked program reads: its active vertex inputs and uniform blocks, taken once at link time.
+// Plain uniforms are reflected by UniformCache. attributeMask has a bit set for every location the
+// program actually reads; inputs the compiler eliminated are not active and don't show up at all.
+struct ProgramReflection {
+	std::vector<AttributeInfo> attributes;
+	std::vector<UniformBlockInfo> blocks;
+	unsigned int attributeMask = 0;
+
+	void build(unsigned int shaderProgram);
+	const AttributeInfo* findAttribute(int location) const;
+	const UniformBlockInfo* findBlock(const char* name) const;
+};
+
+// Locations taken by one element of a vertex input type, e.g. 4 for GL_FLOAT_MAT4.
+int attributeLocations(GLenum type);
+bool isIntegerAttribute(GLenum type);
+
+// Checks the VAO currently bound against what the programs drawn with it read, as a union of their
+// attribute masks. enabledMask is the layout the VAO was set up with. Inputs that aren't enabled, or
+// integer/float mismatches between input and array, are reported; enabled arrays none of the programs read are disabled so
+// they aren't fetched, and arrays a program started reading again (e.g. after a hot reload) are
+// re-enabled. Returns false if anything was reported.
+bool validateVertexLayout(const char* label, unsigned int enabledMask, const ProgramReflection* const* programs, int programCount);
@@ -0,0 +1,167 @@
+#include "ShaderWatcher.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// std::chrono::milliseconds takes it by reference, so it needs a definition
+const int ShaderWatcher::POLL_INTERVAL_MS;
+
+static std::string readFile(const std::string& path, bool& ok) {
+	std::ifstream file(path, std::ios::binary);
+	std::stringstream stream;
+	stream << file.rdbuf();
+	ok = (bool)file;
+	return stream.str();
+}
+
+static std::string parentDirectory(const std::string& path) {
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+ShaderWatcher::~ShaderWatcher() {
+	stop();
+}
+
+bool ShaderWatcher::start(const std::vector<std::string>& paths) {
+	stop();
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd < 0) {
+		std::cout << "ERROR::SHADER_WATCHER::INOTIFY_UNAVAILABLE, polling instead" << std::endl;
+	}
+#endif
+	for (const std::string& path : paths) {
+		addFile(path);
+	}
+	running = true;
+	if (inotifyFd >= 0) {
+		thread = std::thread(&ShaderWatcher::runInotify, this);
+	}
+	else {
+		thread = std::thread(&ShaderWatcher::runPolling, this);
+	}
+	return true;
+}
+
+void ShaderWatcher::stop() {
+	running = false;
+	if (thread.joinable()) {
+		thread.join();
+	}
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		close(inotifyFd);
+	}
+#endif
+	inotifyFd = -1;
+	watchDirectories.clear();
+}
+
+void ShaderWatcher::addFile(const std::string& path) {
+	bool ok;
+	std::string code = readFile(path, ok);
+	std::lock_guard<std::mutex> lock(mutex);
+	if (files.count(path)) {
+		return;
+	}
+	files[path] = std::hash<std::string>()(code);
+	watchDirectory(parentDirectory(path));
+}
+
+void ShaderWatcher::watchDirectory(const std::string& directory) {
+#ifdef __linux__
+	if (inotifyFd < 0) {
+		return;
+	}
+	for (const auto& watch : watchDirectories) {
+		if (watch.second == directory) {
+			return;
+		}
+	}
+	int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (wd < 0) {
+		std::cout << "ERROR::SHADER_WATCHER::WATCH_FAILED " << directory << std::endl;
+		return;
+	}
+	watchDirectories[wd] = directory;
+#endif
+}
+
+void ShaderWatcher::readChange(const std::string& path) {
+	bool ok;
+	std::string code = readFile(path, ok);
+	if (!ok) {
+		return;
+	}
+	size_t hash = std::hash<std::string>()(code);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = files.find(path);
+	if (it == files.end() || it->second == hash) {
+		return;
+	}
+	it->second = hash;
+	changes.push_back({ path, std::move(code), std::chrono::steady_clock::now() });
+}
+
+void ShaderWatcher::runInotify() {
+#ifdef __linux__
+	alignas(inotify_event) char buffer[4096];
+	while (running) {
+		// wake up regularly so stop() never waits long
+		pollfd descriptor = { inotifyFd, POLLIN, 0 };
+		if (poll(&descriptor, 1, POLL_INTERVAL_MS) <= 0) {
+			continue;
+		}
+		ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+		std::vector<std::string> changedPaths;
+		for (ssize_t offset = 0; offset < length;) {
+			const inotify_event* event = (const inotify_event*)(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+			if (event->len == 0) {
+				continue;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			auto directory = watchDirectories.find(event->wd);
+			if (directory != watchDirectories.end()) {
+				changedPaths.push_back(directory->second + "/" + event->name);
+			}
+		}
+		for (const std::string& path : changedPaths) {
+			readChange(path);
+		}
+	}
+#endif
+}
+
+void ShaderWatcher::runPolling() {
+	while (running) {
+		std::vector<std::string> paths;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto& file : files) {
+				paths.push_back(file.first);
+			}
+		}
+		// the contents are compared rather than the modification time, whose one second resolution
+		// misses a second save within the same second; shader files are small enough to re-read
+		for (const std::string& path : paths) {
+			readChange(path);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+	}
+}
+
+void ShaderWatcher::takeChanges(std::vector<ShaderFileChange>& out) {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (ShaderFileChange& change : changes) {
+		out.push_back(std::move(change));
+	}
+	changes.clear();
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// A shader file that changed on disk, already read by the watcher thread.
+struct ShaderFileChange {
+	std::string path;
+	std::string code;
+	std::chrono::steady_clock::time_point detected;
+};
+
+// Watches shader source files from a background thread and queues their new contents, so the render
+// thread only has to recompile. On Linux the parent directories are watched with inotify, which also
+// catches editors that save by writing a new file and renaming it over the old one; elsewhere the
+// files are re-read on every poll. Saves that leave the contents unchanged are dropped.
+class ShaderWatcher {
+private:
+	static const int POLL_INTERVAL_MS = 250;
+
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::mutex mutex; // guards files, changes and the inotify watch table
+	std::vector<ShaderFileChange> changes;
+	// watched path -> hash of the contents last handed out
+	std::unordered_map<std::string, size_t> files;
+	int inotifyFd = -1;
+	std::unordered_map<int, std::string> watchDirectories;
+
+	void watchDirectory(const std::string& directory);
+	void readChange(const std::string& path);
+	void runInotify();
+	void runPolling();
+
+public:
+	~ShaderWatcher();
+
+	bool start(const std::vector<std::string>& paths);
+	void stop();
+	// Files can be added while the watcher runs, e.g. for programs created after startup.
+	void addFile(const std::string& path);
+
+	// Moves the changes queued since the last call into out.
+	void takeChanges(std::vector<ShaderFileChange>& out);
+	bool isUsingInotify() const { return inotifyFd >= 0; }
+};
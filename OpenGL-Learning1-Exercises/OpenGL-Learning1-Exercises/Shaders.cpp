@@ -1,63 +1,557 @@
 #include "Shaders.h"
+#include <algorithm>
+#include <cctype>
 
-unsigned int ShaderLoader::createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
-	// 1. retrieve the vertex/fragment source code from filePath
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	//ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-	try {
-		// open files
-		vShaderFile.open(vertexShaderSource);
-		fShaderFile.open(fragmentShaderSource);
-		std::stringstream vShaderStream, fShaderStream;
-		// read file's buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	}
-	catch (std::ifstream::failure e) {
- 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-	}
-	
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
-
-	unsigned int vertexShaderID;
-	unsigned int fragmentShaderID;
-
-	compileShader(vertexShaderID, vShaderCode, GL_VERTEX_SHADER);
-	compileShader(fragmentShaderID, fShaderCode, GL_FRAGMENT_SHADER);
-
-	unsigned int shaderArray[2] = { vertexShaderID, fragmentShaderID };
-	currentProgram = glCreateProgram();
-	
-	attachShader(currentProgram, shaderArray, 2);
-	return currentProgram;
-}
-
-void ShaderLoader::compileShader(unsigned int &shaderId, const char* shaderSource, int shaderType) {
+#include "FrameConstants.h"
+#include "GLExtensions.h"
+#include "Hash.h"
+#include "Timing.h"
+
+void ShaderReloadStats::print(const char* label) const {
+	std::cout << "SHADER::" << label << " " << reloads << " reloads, " << failures << " failed, last took "
+		<< lastRenderThreadMs << " ms on the render thread and went live " << lastLatencyMs << " ms after the change was seen, "
+		<< totalRenderThreadMs << " ms in total" << std::endl;
+}
+
+void ProgramRegistryStats::print(const char* label, size_t livePrograms, size_t liveStages) const {
+	std::cout << "SHADER::" << label << " " << livePrograms << " programs and " << liveStages << " stages live, "
+		<< requests << " requests, " << sharedPrograms << " shared a program, " << compiledStages << " stages compiled, "
+		<< sharedStages << " shared, " << released << " programs released" << std::endl;
+}
+
+static ProgramSources renderSources(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned long long defineMask) {
+	ProgramSources sources;
+	sources.paths[0] = vertexShaderSource;
+	sources.paths[1] = fragmentShaderSource;
+	sources.defineMask = defineMask;
+	return sources;
+}
+
+static std::string permutationKey(const ProgramSources& sources) {
+	return sources.paths[0] + "\n" + sources.paths[1] + "\n" + std::to_string(sources.defineMask);
+}
+
+// identifies a program by what it is compiled from rather than where that came from
+static unsigned long long programHash(const ProgramSources& sources) {
+	unsigned long long hash = hashBytes(FNV_OFFSET_BASIS, sources.types, sources.stageCount * sizeof(sources.types[0]));
+	return hashBytes(hash, sources.hashes, sources.stageCount * sizeof(sources.hashes[0]));
+}
+
+// copies of a file under another name can preprocess to the same program, so a hash can map to several
+static void unregisterProgramHash(std::unordered_multimap<unsigned long long, unsigned int>& programsByHash, unsigned long long hash, unsigned int shaderProgram) {
+	auto range = programsByHash.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == shaderProgram) {
+			programsByHash.erase(it);
+			return;
+		}
+	}
+}
+
+static bool sameFiles(const std::vector<std::string>& a, const std::vector<std::string>& b) {
+	return a.size() == b.size() && std::is_permutation(a.begin(), a.end(), b.begin());
+}
+
+bool ShaderLoader::preprocess(ProgramSources& sources, PreprocessedSource* stages) {
+	auto start = std::chrono::steady_clock::now();
+	sources.files.clear();
+	bool ok = true;
+	for (int stage = 0; stage < sources.stageCount; stage++) {
+		ok = preprocessor.process(sources.paths[stage], sources.defineMask, stages[stage]) && ok;
+		sources.hashes[stage] = stages[stage].hash;
+		for (const std::string& file : stages[stage].files) {
+			if (std::find(sources.files.begin(), sources.files.end(), file) == sources.files.end()) {
+				sources.files.push_back(file);
+			}
+		}
+	}
+	lastReadMs = elapsedMs(start);
+	return ok;
+}
+
+unsigned int ShaderLoader::retainExisting(ProgramSources& sources, PreprocessedSource* stages) {
+	registryStats.requests++;
+	std::string key = permutationKey(sources);
+	auto permutation = permutations.find(key);
+	if (permutation == permutations.end()) {
+		// a permutation not seen before can still preprocess to a program that exists, e.g. when a define
+		// the files never test is set. Only a program built from the same files is shared: hot reload
+		// follows the files, and a copy under another name may be edited apart from the original later
+		// (its stages are still shared, so it only costs a link)
+		preprocess(sources, stages);
+		auto range = programsByHash.equal_range(programHash(sources));
+		auto same = std::find_if(range.first, range.second, [this, &sources](const std::pair<const unsigned long long, unsigned int>& entry) {
+			return sameFiles(programSources[entry.second].files, sources.files);
+		});
+		if (same == range.second) {
+			return 0;
+		}
+		permutation = permutations.emplace(key, same->second).first;
+	}
+	programRecords[permutation->second].refCount++;
+	registryStats.sharedPrograms++;
+	return permutation->second;
+}
+
+PendingProgram ShaderLoader::submitShaderProgram(const ProgramSources& sources, const PreprocessedSource* stages) {
+	PendingProgram pending = submitSources(sources, stages);
+	programSources[pending.program] = sources;
+	permutations[permutationKey(sources)] = pending.program;
+
+	ProgramRecord record;
+	record.refCount = 1;
+	record.sourceHash = programHash(sources);
+	programRecords[pending.program] = record;
+	programsByHash.emplace(record.sourceHash, pending.program);
+	activeShaderPrograms.push_back(pending.program);
+	return pending;
+}
+
+PendingProgram ShaderLoader::submitSources(const ProgramSources& sources, const PreprocessedSource* stages) {
+	auto start = std::chrono::steady_clock::now();
+	PendingProgram pending = {};
+	pending.program = glCreateProgram();
+	pending.submitted = start;
+
+	std::string label = sources.paths[0];
+	for (int stage = 1; stage < sources.stageCount; stage++) {
+		label += " + " + sources.paths[stage];
+	}
+	pending.buildIndex = buildLog.begin(label, pending.program, sources.stageCount, lastReadMs);
+	ProgramBuildMetrics& build = buildLog.get(pending.buildIndex);
+	for (int stage = 0; stage < sources.stageCount; stage++) {
+		for (int length : stages[stage].lengths) {
+			build.sourceBytes += length;
+		}
+	}
+
+	// a cached binary skips compiling and linking entirely; a miss or a rejected binary falls through
+	bool cached = false;
+	if (programCache && programCache->isEnabled()) {
+		auto loadStart = std::chrono::steady_clock::now();
+		pending.cacheKey = programCache->hashKey(sources.hashes, sources.stageCount);
+		cached = programCache->load(pending.cacheKey, pending.program);
+		build.cacheHit = cached;
+		build.linkMs = cached ? elapsedMs(loadStart) : 0.0;
+	}
+
+	if (!cached) {
+		// stages another program already compiled from the same source are attached, not recompiled
+		std::vector<unsigned long long>& stageKeys = programStages[pending.program];
+		for (int stage = 0; stage < sources.stageCount; stage++) {
+			auto compileStart = std::chrono::steady_clock::now();
+			stageKeys.push_back(acquireStage(pending.shaders[stage], stages[stage], sources.types[stage]));
+			build.compileMs[stage] = elapsedMs(compileStart);
+			build.sharedStage[stage] = stageObjects[stageKeys.back()].refCount > 1;
+		}
+
+		auto linkStart = std::chrono::steady_clock::now();
+		if (programCache) {
+			programCache->prepareProgram(pending.program);
+		}
+		attachShader(pending.program, pending.shaders, sources.stageCount);
+		build.linkMs = elapsedMs(linkStart);
+	}
+	pending.submitMs = elapsedMs(start);
+	return pending;
+}
+
+unsigned int ShaderLoader::createProgram(ProgramSources sources) {
+	auto start = std::chrono::steady_clock::now();
+	PreprocessedSource stages[2];
+	unsigned int existing = retainExisting(sources, stages);
+	if (existing) {
+		// already built, or still compiling from an async request, in which case it's finished now
+		for (size_t i = 0; i < pendingPrograms.size(); i++) {
+			if (pendingPrograms[i].program == existing) {
+				PendingProgram pending = pendingPrograms[i];
+				pendingPrograms.erase(pendingPrograms.begin() + i);
+				finishProgram(pending);
+				break;
+			}
+		}
+		makeCurrent(existing);
+		return existing;
+	}
+
+	PendingProgram pending = submitShaderProgram(sources, stages);
+	pending.submitMs = elapsedMs(start);
+	finishProgram(pending);
+
+	makeCurrent(pending.program);
+	return pending.program;
+}
+
+unsigned int ShaderLoader::createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned long long defineMask) {
+	return createProgram(renderSources(vertexShaderSource, fragmentShaderSource, defineMask));
+}
+
+unsigned int ShaderLoader::createComputeProgram(const char* computeShaderSource, unsigned long long defineMask) {
+	ProgramSources sources;
+	sources.paths[0] = computeShaderSource;
+	sources.types[0] = GL_COMPUTE_SHADER;
+	sources.stageCount = 1;
+	sources.defineMask = defineMask;
+	return createProgram(sources);
+}
+
+unsigned int ShaderLoader::createShaderProgramAsync(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned int fallbackProgram, unsigned long long defineMask) {
+	auto start = std::chrono::steady_clock::now();
+	ProgramSources sources = renderSources(vertexShaderSource, fragmentShaderSource, defineMask);
+	PreprocessedSource stages[2];
+	unsigned int existing = retainExisting(sources, stages);
+	if (existing) {
+		return existing;
+	}
+
+	PendingProgram pending = submitShaderProgram(sources, stages);
+	pending.submitMs = elapsedMs(start);
+	fallbackPrograms[pending.program] = fallbackProgram;
+	if (pending.shaders[0] == 0) {
+		// loaded from the cache, nothing to wait for
+		finishProgram(pending);
+	}
+	else {
+		pendingPrograms.push_back(pending);
+	}
+	return pending.program;
+}
+
+int ShaderLoader::pollShaderPrograms() {
+	for (size_t i = 0; i < pendingPrograms.size();) {
+		if (isProgramComplete(pendingPrograms[i])) {
+			PendingProgram pending = pendingPrograms[i];
+			pendingPrograms.erase(pendingPrograms.begin() + i);
+			finishProgram(pending);
+		}
+		else {
+			i++;
+		}
+	}
+	return (int)pendingPrograms.size();
+}
+
+void ShaderLoader::finishShaderPrograms() {
+	while (!pendingPrograms.empty()) {
+		PendingProgram pending = pendingPrograms.front();
+		pendingPrograms.erase(pendingPrograms.begin());
+		finishProgram(pending);
+	}
+}
+
+unsigned int ShaderLoader::resolve(unsigned int shaderProgram) const {
+	auto reloaded = reloadedPrograms.find(shaderProgram);
+	if (reloaded != reloadedPrograms.end()) {
+		return reloaded->second;
+	}
+	auto it = fallbackPrograms.find(shaderProgram);
+	return it == fallbackPrograms.end() ? shaderProgram : it->second;
+}
+
+int ShaderLoader::reloadShaderFile(const std::string& path, const std::string& code, std::chrono::steady_clock::time_point detected) {
+	preprocessor.updateFile(path, code);
+
+	// only the permutations whose include graph contains the file are rebuilt
+	int resubmitted = 0;
+	for (auto& entry : programSources) {
+		ProgramSources& sources = entry.second;
+		if (std::find(sources.files.begin(), sources.files.end(), path) == sources.files.end()) {
+			continue;
+		}
+		unsigned long long previousHashes[2] = { sources.hashes[0], sources.hashes[1] };
+		PreprocessedSource stages[2];
+		if (!preprocess(sources, stages) || (sources.hashes[0] == previousHashes[0] && sources.hashes[1] == previousHashes[1])) {
+			// a broken include is reported by the preprocessor; a save that leaves the text as it was
+			// changes nothing
+			continue;
+		}
+		// later requests for the edited sources find this program, not a stale one
+		ProgramRecord& record = programRecords[entry.first];
+		unregisterProgramHash(programsByHash, record.sourceHash, entry.first);
+		record.sourceHash = programHash(sources);
+		programsByHash.emplace(record.sourceHash, entry.first);
+
+		// an older reload still compiling would otherwise go live after this one if it finished later
+		abandonReloads(entry.first);
+		PendingProgram pending = submitSources(sources, stages);
+		pending.replaces = entry.first;
+		pending.detected = detected;
+		if (pending.shaders[0] == 0) {
+			// the edit went back to a version that is still in the binary cache
+			finishProgram(pending);
+		}
+		else {
+			pendingPrograms.push_back(pending);
+		}
+		resubmitted++;
+	}
+	return resubmitted;
+}
+
+void ShaderLoader::abandonReloads(unsigned int shaderProgram) {
+	for (size_t i = 0; i < pendingPrograms.size();) {
+		if (pendingPrograms[i].replaces == shaderProgram) {
+			deleteProgramObject(pendingPrograms[i].program);
+			pendingPrograms.erase(pendingPrograms.begin() + i);
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+std::vector<std::string> ShaderLoader::getShaderFiles() const {
+	std::vector<std::string> files;
+	for (const auto& entry : programSources) {
+		for (const std::string& file : entry.second.files) {
+			if (std::find(files.begin(), files.end(), file) == files.end()) {
+				files.push_back(file);
+			}
+		}
+	}
+	return files;
+}
+
+void ShaderLoader::deleteProgramObject(unsigned int shaderProgram) {
+	glDeleteProgram(shaderProgram);
+	releaseStages(shaderProgram);
+	uniformCaches.erase(shaderProgram);
+	reflections.erase(shaderProgram);
+	if (stateCache) {
+		stateCache->forgetProgram(shaderProgram);
+	}
+	if (currentProgram == shaderProgram) {
+		currentProgram = 0;
+		currentUniforms = nullptr;
+	}
+}
+
+bool ShaderLoader::isProgramComplete(const PendingProgram& pending) const {
+	if (!glExtensions.hasParallelShaderCompile) {
+		return true;
+	}
+	int complete = 0;
+	glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete != 0;
+}
+
+void ShaderLoader::finishProgram(const PendingProgram& pending) {
+	auto start = std::chrono::steady_clock::now();
+	unsigned int program = pending.program;
+	ProgramBuildMetrics& build = buildLog.get(pending.buildIndex);
+	build.replaces = pending.replaces;
+
+	// each stage's status is waited for on its own first, so a driver finishing compiles in the
+	// background charges a slow stage to compiling rather than to linking
+	int success;
+	int logLength = 0;
+	for (int i = 0; i < build.stageCount; i++) {
+		if (pending.shaders[i] && !build.sharedStage[i]) {
+			auto waitStart = std::chrono::steady_clock::now();
+			glGetShaderiv(pending.shaders[i], GL_COMPILE_STATUS, &success);
+			build.compileMs[i] += elapsedMs(waitStart);
+			glGetShaderiv(pending.shaders[i], GL_INFO_LOG_LENGTH, &logLength);
+			build.infoLogBytes += logLength;
+		}
+	}
+	char infoLog[512];
+	auto waitStart = std::chrono::steady_clock::now();
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	build.linkMs += elapsedMs(waitStart);
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+	build.infoLogBytes += logLength;
+	double wallMs = build.readMs + elapsedMs(pending.submitted);
+	buildLog.finish(pending.buildIndex, success != 0, wallMs);
+	if (!success) {
+		// the shader logs explain most link failures, so they're only read when linking failed
+		for (int i = 0; i < build.stageCount; i++) {
+			if (pending.shaders[i]) {
+				checkShader(pending.shaders[i]);
+			}
+		}
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::LINKING_FAILED\n" << infoLog << std::endl;
+		if (pending.replaces) {
+			std::cout << "ERROR::SHADER::RELOAD_FAILED, keeping the previous program" << std::endl;
+			deleteProgramObject(program);
+			reloadStats.failures++;
+		}
+		else if (reloadedPrograms.find(program) == reloadedPrograms.end()) {
+			// a dead program isn't handed out again, so the next request for it compiles afresh. Unless
+			// a reload already replaced it, which then stays; the fallback, if any, stays in place too
+			unregisterProgram(program);
+		}
+		return;
+	}
+	if (pending.shaders[0] && programCache) {
+		programCache->store(pending.cacheKey, program);
+	}
+
+	ProgramReflection& reflection = reflections[program];
+	reflection.build(program);
+
+	// every program that reads the per-frame constants shares the one buffer at the fixed binding point
+	const UniformBlockInfo* frameConstantsBlock = reflection.findBlock(FRAME_CONSTANTS_BLOCK_NAME);
+	if (frameConstantsBlock) {
+		glUniformBlockBinding(program, frameConstantsBlock->index, FRAME_CONSTANTS_BINDING);
+		if (frameConstantsBlock->dataSize != (int)sizeof(FrameConstants)) {
+			std::cout << "ERROR::SHADER::BLOCK_SIZE_MISMATCH " << FRAME_CONSTANTS_BLOCK_NAME << " is " << frameConstantsBlock->dataSize
+				<< " bytes in the shader, " << sizeof(FrameConstants) << " on the CPU" << std::endl;
+		}
+	}
+
+	UniformCache& uniforms = uniformCaches[program];
+	uniforms.build(program);
+	fallbackPrograms.erase(program);
+
+	double buildMs = pending.submitMs + elapsedMs(start);
+	if (programCache) {
+		programCache->addBuildTime(buildMs);
+	}
+	if (pending.replaces) {
+		// swap: from here on resolve() hands out the new program; an earlier replacement is deleted,
+		// the original name is kept alive so it can never be recycled for another program
+		auto previous = reloadedPrograms.find(pending.replaces);
+		if (previous != reloadedPrograms.end()) {
+			deleteProgramObject(previous->second);
+		}
+		else {
+			releaseStages(pending.replaces);
+		}
+		reloadedPrograms[pending.replaces] = program;
+		fallbackPrograms.erase(pending.replaces);
+
+		reloadStats.reloads++;
+		reloadStats.lastRenderThreadMs = buildMs;
+		reloadStats.lastLatencyMs = elapsedMs(pending.detected);
+		reloadStats.totalRenderThreadMs += buildMs;
+		reloadStats.print("RELOADED");
+	}
+	checkVertexLayouts(pending.replaces ? pending.replaces : program);
+	if (programReadyCallback) {
+		programReadyCallback(program);
+	}
+}
+
+void ShaderLoader::bindVertexArray(unsigned int vao) {
+	if (stateCache) {
+		stateCache->bindVertexArray(vao);
+	}
+	else {
+		glBindVertexArray(vao);
+	}
+}
+
+void ShaderLoader::registerVertexArray(const char* label, unsigned int vao, const std::vector<unsigned int>& programs) {
+	VertexArrayLayout layout;
+	layout.label = label;
+	layout.vao = vao;
+	layout.enabledMask = 0;
+	layout.programs = programs;
+
+	int maxAttributes = 0;
+	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttributes);
+	bindVertexArray(vao);
+	for (int location = 0; location < maxAttributes && location < MASKED_ATTRIBUTE_LOCATIONS; location++) {
+		int enabled = 0;
+		glGetVertexAttribiv(location, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+		if (enabled) {
+			layout.enabledMask |= 1u << location;
+		}
+	}
+	vertexLayouts.push_back(layout);
+	checkVertexLayout(vertexLayouts.back());
+}
+
+const ProgramReflection* ShaderLoader::getReflection(unsigned int shaderProgram) const {
+	if (!isProgramReady(shaderProgram)) {
+		return nullptr;
+	}
+	auto it = reflections.find(resolve(shaderProgram));
+	return it == reflections.end() ? nullptr : &it->second;
+}
+
+void ShaderLoader::checkVertexLayouts(unsigned int shaderProgram) {
+	for (const VertexArrayLayout& layout : vertexLayouts) {
+		if (std::find(layout.programs.begin(), layout.programs.end(), shaderProgram) != layout.programs.end()) {
+			checkVertexLayout(layout);
+		}
+	}
+}
+
+void ShaderLoader::checkVertexLayout(const VertexArrayLayout& layout) {
+	// wait until every program drawn with the VAO has linked, so no input is stripped that one of them reads
+	std::vector<const ProgramReflection*> programReflections;
+	for (unsigned int program : layout.programs) {
+		const ProgramReflection* reflection = getReflection(program);
+		if (!reflection) {
+			return;
+		}
+		programReflections.push_back(reflection);
+	}
+	bindVertexArray(layout.vao);
+	validateVertexLayout(layout.label.c_str(), layout.enabledMask, programReflections.data(), (int)programReflections.size());
+}
+
+void ShaderLoader::compileShader(unsigned int &shaderId, const PreprocessedSource& shaderSource, int shaderType) {
 	shaderId = glCreateShader(shaderType);
-	shaderIds.push_back(shaderId);
-	glShaderSource(shaderId, 1, &shaderSource, NULL);
+	// the segments go to the driver as they are, with explicit lengths, without being joined first; a file
+	// caught empty mid-save has none, and a null string array is rejected rather than failing to compile
+	if (shaderSource.strings.empty()) {
+		const char* empty = "";
+		glShaderSource(shaderId, 1, &empty, NULL);
+	}
+	else {
+		glShaderSource(shaderId, (int)shaderSource.strings.size(), shaderSource.strings.data(), shaderSource.lengths.data());
+	}
 	glCompileShader(shaderId);
+}
+
+unsigned long long ShaderLoader::acquireStage(unsigned int& shaderId, const PreprocessedSource& shaderSource, unsigned int shaderType) {
+	unsigned long long key = hashBytes(shaderSource.hash, &shaderType, sizeof(shaderType));
+	auto it = stageObjects.find(key);
+	if (it != stageObjects.end()) {
+		it->second.refCount++;
+		shaderId = it->second.shader;
+		registryStats.sharedStages++;
+		return key;
+	}
+	compileShader(shaderId, shaderSource, shaderType);
+	StageObject stage;
+	stage.shader = shaderId;
+	stage.refCount = 1;
+	stageObjects[key] = stage;
+	registryStats.compiledStages++;
+	return key;
+}
+
+void ShaderLoader::releaseStages(unsigned int shaderProgram) {
+	auto it = programStages.find(shaderProgram);
+	if (it == programStages.end()) {
+		return;
+	}
+	for (unsigned long long key : it->second) {
+		auto stage = stageObjects.find(key);
+		if (stage != stageObjects.end() && --stage->second.refCount == 0) {
+			// programs still holding it attached keep the driver's copy alive until they go
+			glDeleteShader(stage->second.shader);
+			stageObjects.erase(stage);
+		}
+	}
+	programStages.erase(it);
+}
 
+bool ShaderLoader::checkShader(unsigned int shaderId) {
 	int success;
 	char infoLog[512];
 	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
 	if (!success) {
+		int shaderType;
+		glGetShaderiv(shaderId, GL_SHADER_TYPE, &shaderType);
 		glGetShaderInfoLog(shaderId, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::" << (shaderType == 0x8B30 ? "FRAGMENT" : (shaderType == 0x8B31 ? "VERTEX" : "UNKOWN_SHADER")) << "COMPILATION_FAILED\n" << infoLog << std::endl << std::endl;
+		std::cout << "ERROR::SHADER::" << (shaderType == 0x8B30 ? "FRAGMENT" : (shaderType == 0x8B31 ? "VERTEX" : (shaderType == GL_COMPUTE_SHADER ? "COMPUTE" : "UNKOWN_SHADER"))) << "COMPILATION_FAILED\n" << infoLog << std::endl << std::endl;
 	}
+	return success != 0;
 }
 
 void ShaderLoader::attachShader(unsigned int& shaderProgram, unsigned int *shaderArray, int shaderArraySize) {
@@ -65,51 +559,142 @@ void ShaderLoader::attachShader(unsigned int& shaderProgram, unsigned int *shade
 		glAttachShader(shaderProgram, shaderArray[i]);
 	}
 	glLinkProgram(shaderProgram);
-	
+}
 
-	int success;
-	char infoLog[512];
+void APIENTRY ShaderLoader::driverMessageCallback(GLenum /*source*/, GLenum /*type*/, GLuint /*id*/, GLenum /*severity*/, GLsizei length, const GLchar* message, const void* userParam) {
+	// only performance messages get here; drivers word recompiles differently ("is being recompiled
+	// based on GL state", "Recompiling fragment shader"), so the text is matched loosely
+	std::string text = length < 0 ? std::string(message) : std::string(message, length);
+	std::string lowered = text;
+	std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	if (lowered.find("recompil") == std::string::npos) {
+		return;
+	}
+	// draws bind programs through the state cache without always going through use(), so what the cache
+	// saw bound last is the program the driver is drawing with
+	ShaderLoader* loader = (ShaderLoader*)userParam;
+	unsigned int program = loader->stateCache && loader->stateCache->getProgram() ? loader->stateCache->getProgram() : loader->currentProgram;
+	loader->buildLog.addDriverRecompile(program);
+	std::cout << "SHADER::DRIVER_RECOMPILE program " << program << ": " << text << std::endl;
+}
 
-	for (int i = 0; i < shaderArraySize; i++) {
-		glDeleteShader(shaderArray[i]);
+bool ShaderLoader::trackDriverRecompiles() {
+	if (!glExtensions.hasDebugOutput) {
+		return false;
 	}
+	// synchronous, so each message arrives on this thread while the program it is about is still in use
+	glEnable(GL_DEBUG_OUTPUT);
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glExtensions.debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	glExtensions.debugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+	glExtensions.debugMessageCallback(driverMessageCallback, this);
+	return true;
+}
 
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::LINKING_FAILED\n" << infoLog << std::endl;
+bool ShaderLoader::releaseShaderProgram(unsigned int shaderProgram) {
+	auto record = programRecords.find(shaderProgram);
+	if (record == programRecords.end()) {
+		return false;
+	}
+	if (--record->second.refCount > 0) {
+		return true;
+	}
+
+	unregisterProgram(shaderProgram);
+	fallbackPrograms.erase(shaderProgram);
+	registryStats.released++;
+	return true;
+}
+
+void ShaderLoader::unregisterProgram(unsigned int shaderProgram) {
+	// compiles still in flight for it, the first build or a reload, are abandoned
+	for (size_t i = 0; i < pendingPrograms.size();) {
+		const PendingProgram& pending = pendingPrograms[i];
+		if (pending.program == shaderProgram || pending.replaces == shaderProgram) {
+			if (pending.program != shaderProgram) {
+				deleteProgramObject(pending.program);
+			}
+			pendingPrograms.erase(pendingPrograms.begin() + i);
+		}
+		else {
+			i++;
+		}
+	}
+	auto reloaded = reloadedPrograms.find(shaderProgram);
+	if (reloaded != reloadedPrograms.end()) {
+		deleteProgramObject(reloaded->second);
+		reloadedPrograms.erase(reloaded);
 	}
+	deleteProgramObject(shaderProgram);
+
+	for (auto it = permutations.begin(); it != permutations.end();) {
+		it = it->second == shaderProgram ? permutations.erase(it) : std::next(it);
+	}
+	auto record = programRecords.find(shaderProgram);
+	unregisterProgramHash(programsByHash, record->second.sourceHash, shaderProgram);
+	programSources.erase(shaderProgram);
+	programRecords.erase(record);
+	activeShaderPrograms.erase(std::find(activeShaderPrograms.begin(), activeShaderPrograms.end(), shaderProgram));
 }
 
 bool ShaderLoader::deleteActiveShaderProgram(unsigned int activeShader) {
-	for (int i = 0; i < activeShaderPrograms.size(); i++) {
-		if (activeShaderPrograms[i] == activeShader) {
-			glDeleteProgram(activeShaderPrograms[i]);
-			activeShaderPrograms.erase(activeShaderPrograms.begin() + i);
-			return true;
-		}
+	auto record = programRecords.find(activeShader);
+	if (record == programRecords.end()) {
+		return false;
 	}
-	return false;
+	record->second.refCount = 1;
+	return releaseShaderProgram(activeShader);
 }
 
 bool ShaderLoader::clearActiveShaderPrograms() {
-	for (int i = 0; i < activeShaderPrograms.size(); i++) {
-		glDeleteProgram(activeShaderPrograms[i]);
+	while (!activeShaderPrograms.empty()) {
+		deleteActiveShaderProgram(activeShaderPrograms.back());
 	}
-	activeShaderPrograms.clear();
 	return activeShaderPrograms.empty();
 }
 
 void ShaderLoader::use() {
-	glUseProgram(currentProgram);
+	if (stateCache) {
+		stateCache->useProgram(currentProgram);
+	}
+	else {
+		glUseProgram(currentProgram);
+	}
 }
 
-void ShaderLoader::setBool(const std::string& name, bool value) const {
-	glUniform1i(glGetUniformLocation(currentProgram, name.c_str()), (int)value);
+void ShaderLoader::makeCurrent(unsigned int shaderProgram) {
+	if (shaderProgram != currentProgram) {
+		currentProgram = shaderProgram;
+		auto it = uniformCaches.find(currentProgram);
+		currentUniforms = it == uniformCaches.end() ? nullptr : &it->second;
+	}
 }
-void ShaderLoader::setInt(const std::string & name, int value) const {
-	glUniform1i(glGetUniformLocation(currentProgram, name.c_str()), value);
+
+void ShaderLoader::use(unsigned int shaderProgram) {
+	makeCurrent(shaderProgram);
+	use();
+}
+
+void ShaderLoader::setBool(const std::string& name, bool value) {
+	setBool(getUniformHandle(name), value);
+}
+void ShaderLoader::setInt(const std::string & name, int value) {
+	setInt(getUniformHandle(name), value);
+}
+void ShaderLoader::setFloat(const std::string& name, float value) {
+	setFloat(getUniformHandle(name), value);
+}
+
+int ShaderLoader::getUniformHandle(const std::string& name) const {
+	return currentUniforms ? currentUniforms->find(name) : UniformCache::INVALID_HANDLE;
+}
+int ShaderLoader::getUniformHandle(unsigned int shaderProgram, const std::string& name) const {
+	auto it = uniformCaches.find(shaderProgram);
+	return it == uniformCaches.end() ? UniformCache::INVALID_HANDLE : it->second.find(name);
+}
+
+void ShaderLoader::flushUniforms() {
+	if (currentUniforms && currentUniforms->isDirty()) {
+		currentUniforms->flush(uniformStats);
+	}
 }
-void ShaderLoader::setFloat(const std::string& name, float value) const {
-	glUniform1f(glGetUniformLocation(currentProgram, name.c_str()), value);
-}
\ No newline at end of file
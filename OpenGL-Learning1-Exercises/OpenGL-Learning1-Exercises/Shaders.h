@@ -6,24 +6,240 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <glm/glm.hpp>
+
+#include "UniformCache.h"
+#include "StateCache.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderReflection.h"
+#include "ShaderMetrics.h"
+
+// A program whose compile and link have been submitted but whose status hasn't been read back yet.
+struct PendingProgram {
+	unsigned int program;
+	unsigned int shaders[2]; // 0 when the program came from the binary cache
+	unsigned long long cacheKey;
+	double submitMs; // CPU time spent submitting, added to the cache's build time when finished
+	unsigned int replaces; // for a hot reload, the program handed out by create*, otherwise 0
+	std::chrono::steady_clock::time_point detected; // when the watcher saw the change
+	std::chrono::steady_clock::time_point submitted;
+	int buildIndex; // its entry in the build log
+};
+
+// Where a program's stages came from, the defines they were built with, and the hashes of the
+// preprocessed sources they were last compiled from. files is the include graph of all stages,
+// used by hot reload. Render programs have a vertex and a fragment stage, compute programs one.
+struct ProgramSources {
+	std::string paths[2];
+	unsigned int types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	int stageCount = 2;
+	unsigned long long defineMask = 0;
+	unsigned long long hashes[2] = {};
+	std::vector<std::string> files;
+};
+
+// A VAO and the programs drawn with it, checked against their reflected inputs once they have linked.
+struct VertexArrayLayout {
+	std::string label;
+	unsigned int vao;
+	unsigned int enabledMask; // arrays enabled when the VAO was registered
+	std::vector<unsigned int> programs;
+};
+
+// A name handed out by create*, shared by every request for the same files and preprocessed sources.
+struct ProgramRecord {
+	unsigned int refCount;
+	unsigned long long sourceHash;
+};
+
+// A compiled stage, shared by every program whose stage has the same type and preprocessed source.
+struct StageObject {
+	unsigned int shader;
+	unsigned int refCount; // programs linked or linking from it
+};
+
+struct ProgramRegistryStats {
+	unsigned int requests = 0;       // create* calls
+	unsigned int sharedPrograms = 0; // requests answered with an existing program
+	unsigned int compiledStages = 0;
+	unsigned int sharedStages = 0;   // stages attached from another program instead of compiled
+	unsigned int released = 0;       // programs deleted after their last reference was released
+
+	void print(const char* label, size_t livePrograms, size_t liveStages) const;
+};
+
+struct ShaderReloadStats {
+	unsigned int reloads = 0;
+	unsigned int failures = 0;
+	double lastRenderThreadMs = 0.0; // submit + finish work done on the render thread for the last reload
+	double lastLatencyMs = 0.0;      // from the watcher seeing the change to the new program going live
+	double totalRenderThreadMs = 0.0;
+
+	void print(const char* label) const;
+};
 
 class ShaderLoader {
 private:
+	// every name create* has handed out and not yet released, with its reference count; the registry
+	// is keyed by the hash of the preprocessed stages, so requests with define sets that produce the
+	// same sources from the same files share one program
 	std::vector<unsigned int> activeShaderPrograms;
-	std::vector<unsigned int> shaderIds;
-	unsigned int currentProgram;
+	std::unordered_map<unsigned int, ProgramRecord> programRecords;
+	std::unordered_multimap<unsigned long long, unsigned int> programsByHash;
+	// compiled stages by (type, source hash), and the stages each program object was linked from
+	std::unordered_map<unsigned long long, StageObject> stageObjects;
+	std::unordered_map<unsigned int, std::vector<unsigned long long>> programStages;
+	ProgramRegistryStats registryStats;
+	unsigned int currentProgram = 0;
+	// active uniforms and their shadow values for every linked program, and the table belonging to
+	// currentProgram
+	std::unordered_map<unsigned int, UniformCache> uniformCaches;
+	UniformCache* currentUniforms = nullptr;
+	UniformUploadStats uniformStats;
+	// active inputs and uniform blocks of every linked program
+	std::unordered_map<unsigned int, ProgramReflection> reflections;
+	std::vector<VertexArrayLayout> vertexLayouts;
+	GLStateCache* stateCache = nullptr;
+	ProgramBinaryCache* programCache = nullptr;
+
+	// programs still compiling, and the program to draw with instead until each one is ready
+	std::vector<PendingProgram> pendingPrograms;
+	std::unordered_map<unsigned int, unsigned int> fallbackPrograms;
+	std::function<void(unsigned int)> programReadyCallback;
+
+	// sources of every program by the name create* returned; a successful hot reload maps that name
+	// to its replacement, which resolve() hands out from then on
+	std::unordered_map<unsigned int, ProgramSources> programSources;
+	std::unordered_map<unsigned int, unsigned int> reloadedPrograms;
+	ShaderReloadStats reloadStats;
+	ShaderBuildLog buildLog;
+	double lastReadMs = 0.0; // time the last preprocess() call took, charged to the build it was for
+
+	// every permutation requested so far, keyed by (stage files, define mask); each is built once
+	ShaderPreprocessor preprocessor;
+	std::unordered_map<std::string, unsigned int> permutations;
 
-	void compileShader(unsigned int& shaderId, const char* shaderSource, int shaderType);
+	// Compile and link are only submitted here; their status is read by finishProgram so a driver
+	// with background compiler threads isn't forced to finish each one before the next is submitted.
+	void compileShader(unsigned int& shaderId, const PreprocessedSource& shaderSource, int shaderType);
+	unsigned long long acquireStage(unsigned int& shaderId, const PreprocessedSource& shaderSource, unsigned int shaderType);
+	void releaseStages(unsigned int shaderProgram);
 	void attachShader(unsigned int& shaderProgram, unsigned int* shaderArray, int shaderArraySize);
+	bool checkShader(unsigned int shaderId);
+	bool isProgramComplete(const PendingProgram& pending) const;
+	void finishProgram(const PendingProgram& pending);
+	// Deletes the programs of hot reloads of shaderProgram that are still compiling.
+	void abandonReloads(unsigned int shaderProgram);
+	bool preprocess(ProgramSources& sources, PreprocessedSource* stages);
+	unsigned int retainExisting(ProgramSources& sources, PreprocessedSource* stages);
+	PendingProgram submitShaderProgram(const ProgramSources& sources, const PreprocessedSource* stages);
+	PendingProgram submitSources(const ProgramSources& sources, const PreprocessedSource* stages);
+	unsigned int createProgram(ProgramSources sources);
+	// Makes shaderProgram the one the setters and use() act on, without binding it.
+	void makeCurrent(unsigned int shaderProgram);
+	void deleteProgramObject(unsigned int shaderProgram);
+	// Deletes shaderProgram, its compiles still in flight and its hot-reloaded replacement, and drops
+	// it from the registry so no later request is handed it.
+	void unregisterProgram(unsigned int shaderProgram);
+	void bindVertexArray(unsigned int vao);
+	void checkVertexLayouts(unsigned int shaderProgram);
+	void checkVertexLayout(const VertexArrayLayout& layout);
+	static void APIENTRY driverMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
 
 public:
-	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
-	std::vector<unsigned int> getActiveShaderPrograms;
+	// Every create function runs the sources through the preprocessor with the defines in defineMask
+	// (see defineBit). When the same permutation, or a request for the same files whose preprocessed
+	// sources are identical, was made before, the existing program is returned with one more
+	// reference. Each request should be paired with a releaseShaderProgram call. A program that fails
+	// to link is deleted and forgotten instead, with no reference left to release, so the next request
+	// for it compiles again.
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned long long defineMask = 0);
+	unsigned long long defineBit(const std::string& name) { return preprocessor.defineBit(name); }
+	// Builds a compute program synchronously, with the same preprocessing, caching and hot reload.
+	// Needs glExtensions.hasComputeShader.
+	unsigned int createComputeProgram(const char* computeShaderSource, unsigned long long defineMask = 0);
+
+	// Submits the program and returns its name straight away. Until pollShaderPrograms reports it
+	// finished, resolve() hands out fallbackProgram in its place, and so does it after a failed link.
+	// Uniforms can only be set once the program is ready; use the ready callback for that.
+	unsigned int createShaderProgramAsync(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned int fallbackProgram, unsigned long long defineMask = 0);
+	// Finishes every pending program whose compile and link are done, without blocking when
+	// KHR_parallel_shader_compile is available; without it the first query waits for the driver.
+	// Returns how many programs are still pending.
+	int pollShaderPrograms();
+	void finishShaderPrograms();
+	bool isProgramReady(unsigned int shaderProgram) const { return fallbackPrograms.find(shaderProgram) == fallbackPrograms.end(); }
+	unsigned int resolve(unsigned int shaderProgram) const;
+
+	// Hot reload: recompiles every program whose include graph contains path, through the same
+	// non-blocking path. The program resolve() returns is only swapped once the new one has linked;
+	// a failed reload keeps the old program running. Returns how many programs were resubmitted.
+	int reloadShaderFile(const std::string& path, const std::string& code, std::chrono::steady_clock::time_point detected);
+	std::vector<std::string> getShaderFiles() const;
+	const ShaderReloadStats& getReloadStats() const { return reloadStats; }
+	// Read, compile and link times, source and info log sizes and the cache outcome of every program
+	// built so far, hot reloads included; see ProgramBuildMetrics.
+	const ShaderBuildLog& getBuildLog() const { return buildLog; }
+	void printBuildReport(const char* label, int slowest = 5) const { buildLog.printReport(label, slowest); }
+	// Listens for driver performance messages about recompiling a program behind our back, typically
+	// for GL state the shader was compiled without, and charges them to the program bound. Needs
+	// glExtensions.hasDebugOutput; returns false without it.
+	bool trackDriverRecompiles();
+	// Records which programs draw with vao and checks the VAO against their active inputs as soon as all
+	// of them have linked, again after each hot reload of one of them. Arrays none of them read are
+	// disabled, so the vertex format only fetches what the shaders use. Call with the VAO fully set up.
+	void registerVertexArray(const char* label, unsigned int vao, const std::vector<unsigned int>& programs);
+	// Reflection of the program resolve() currently hands out for shaderProgram, null until it has linked.
+	const ProgramReflection* getReflection(unsigned int shaderProgram) const;
+	// Called with each program once it has linked successfully, including synchronously created ones.
+	void setProgramReadyCallback(std::function<void(unsigned int)> callback) { programReadyCallback = callback; }
+	// Drops one reference; the last one deletes the program, its hot-reloaded replacement and any stage
+	// objects no other program uses. Returns false for names that aren't live.
+	bool releaseShaderProgram(unsigned int shaderProgram);
+	const std::vector<unsigned int>& getActiveShaderPrograms() const { return activeShaderPrograms; }
+	const ProgramRegistryStats& getRegistryStats() const { return registryStats; }
+	void printRegistryStats(const char* label) const { registryStats.print(label, programRecords.size(), stageObjects.size()); }
+	// Releases activeShader whatever its reference count.
 	bool deleteActiveShaderProgram(unsigned int activeShader);
 	bool clearActiveShaderPrograms();
 
+	// When set, use() goes through the state cache and skips redundant glUseProgram calls.
+	void setStateCache(GLStateCache* cache) { stateCache = cache; }
+	// When set, createShaderProgram loads linked binaries from the cache and stores new ones in it.
+	void setProgramCache(ProgramBinaryCache* cache) { programCache = cache; }
 	void use();
-	void setBool(const std::string& name, bool value) const;
-	void setInt(const std::string& name, int value) const;
-	void setFloat(const std::string& name, float value) const;
+	void use(unsigned int shaderProgram);
+	void setBool(const std::string& name, bool value);
+	void setInt(const std::string& name, int value);
+	void setFloat(const std::string& name, float value);
+
+	// Handles are resolved once through the uniform cache and are specific to the program they were
+	// looked up in. Passing UniformCache::INVALID_HANDLE is a no-op, like location -1 in GL.
+	int getUniformHandle(const std::string& name) const;
+	int getUniformHandle(unsigned int shaderProgram, const std::string& name) const;
+	void setBool(int handle, bool value) { setUniform(handle, (int)value); }
+	void setInt(int handle, int value) { setUniform(handle, value); }
+	void setFloat(int handle, float value) { setUniform(handle, value); }
+
+	// Typed setters for the current program: float, int and unsigned int, their glm vectors, and mat2/3/4.
+	// Values only go into the program's shadow block; nothing reaches GL until flushUniforms, which
+	// uploads just the values that differ from what the program already holds. Samplers and bools are
+	// set with int. The array form writes count elements starting at firstElement.
+	template<typename T>
+	void setUniform(int handle, const T& value) { setUniform(handle, &value, 1); }
+	template<typename T>
+	void setUniform(int handle, const T* values, int count, int firstElement = 0) {
+		if (currentUniforms) {
+			currentUniforms->write(handle, UniformValueType<T>::value, values, firstElement, count, uniformStats);
+		}
+	}
+	template<typename T>
+	void setUniform(const std::string& name, const T& value) { setUniform(getUniformHandle(name), value); }
+	// Call right before drawing with the current program.
+	void flushUniforms();
+	const UniformUploadStats& getUniformStats() const { return uniformStats; }
 };
\ No newline at end of file
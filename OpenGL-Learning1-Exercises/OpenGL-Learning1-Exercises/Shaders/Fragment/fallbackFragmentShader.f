@@ -0,0 +1,8 @@
+#version 330 core
+
+out vec4 FragColor;
+
+// drawn in place of programs that are still compiling or failed to link
+void main() {
+    FragColor = vec4(0.5, 0.5, 0.5, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoord;
+flat in vec2 TextureLayers;
+
+uniform sampler2DArray textures;
+
+void main() {
+    FragColor = mix(texture(textures, vec3(TexCoord, TextureLayers.x)),
+                    texture(textures, vec3(TexCoord, TextureLayers.y)), 0.2);
+}
@@ -1,17 +1,20 @@
 #version 330 core
 layout(location = 0) in vec3 aPos; // "position" has attribute position 0
-layout(location = 1) in vec3 aColor; // "color" has attribute position 1
 layout(location = 2) in vec2 aTexCoord;
-
+#ifdef INSTANCED
+layout(location = 3) in mat4 aInstanceModel; // occupies locations 3-6, advanced once per instance
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+#include "../Include/frameConstants.glsl"
 
-out vec3 ourColor;
 out vec2 TexCoord;
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    ourColor = aColor; // output color
+#ifdef INSTANCED
+    mat4 model = aInstanceModel;
+#endif
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
     TexCoord = aTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 2) in vec2 aTexCoord;
+layout(location = 3) in mat4 aInstanceModel; // occupies locations 3-6, advanced once per instance
+layout(location = 7) in vec2 aTextureLayers; // base and overlay layer in the texture array
+
+#include "../Include/frameConstants.glsl"
+
+out vec2 TexCoord;
+flat out vec2 TextureLayers;
+
+void main() {
+    gl_Position = viewProjection * aInstanceModel * vec4(aPos, 1.0);
+    TexCoord = aTexCoord;
+    TextureLayers = aTextureLayers;
+}
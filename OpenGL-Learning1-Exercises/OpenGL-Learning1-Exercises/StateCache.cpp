@@ -0,0 +1,215 @@
+#include "StateCache.h"
+#include <iostream>
+
+static const char* stateCallNames[STATE_CALL_COUNT] = {
+	"program", "vertexArray", "activeTexture", "texture", "buffer", "polygonMode", "depth"
+};
+
+unsigned int StateCacheStats::totalIssued() const {
+	unsigned int total = 0;
+	for (int i = 0; i < STATE_CALL_COUNT; i++) {
+		total += issued[i];
+	}
+	return total;
+}
+
+unsigned int StateCacheStats::totalElided() const {
+	unsigned int total = 0;
+	for (int i = 0; i < STATE_CALL_COUNT; i++) {
+		total += elided[i];
+	}
+	return total;
+}
+
+void StateCacheStats::reset() {
+	for (int i = 0; i < STATE_CALL_COUNT; i++) {
+		issued[i] = 0;
+		elided[i] = 0;
+	}
+}
+
+void StateCacheStats::print(const char* label) const {
+	std::cout << "STATE_CACHE::" << label << " issued " << totalIssued() << ", elided " << totalElided() << std::endl;
+	for (int i = 0; i < STATE_CALL_COUNT; i++) {
+		if (issued[i] || elided[i]) {
+			std::cout << "\t" << stateCallNames[i] << ": " << issued[i] << " issued, " << elided[i] << " elided" << std::endl;
+		}
+	}
+}
+
+GLStateCache::GLStateCache() {
+	invalidate();
+	frameStats.reset();
+	lastFrameStats.reset();
+}
+
+void GLStateCache::invalidate() {
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeTextureUnit = UNKNOWN;
+	for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+		for (int target = 0; target < TEXTURE_TARGET_COUNT; target++) {
+			textures[unit][target] = UNKNOWN;
+		}
+	}
+	for (int target = 0; target < BUFFER_TARGET_COUNT; target++) {
+		buffers[target] = UNKNOWN;
+	}
+	polygonMode = UNKNOWN;
+	depthTest = UNKNOWN;
+	depthMask = UNKNOWN;
+	depthFunc = UNKNOWN;
+}
+
+void GLStateCache::beginFrame() {
+	lastFrameStats = frameStats;
+	frameStats.reset();
+}
+
+int GLStateCache::textureTargetIndex(GLenum target) {
+	switch (target) {
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_CUBE_MAP: return 2;
+	default: return -1;
+	}
+}
+
+int GLStateCache::bufferTargetIndex(GLenum target) {
+	switch (target) {
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_ELEMENT_ARRAY_BUFFER: return 1;
+	case GL_UNIFORM_BUFFER: return 2;
+	case GL_PIXEL_UNPACK_BUFFER: return 3;
+	case GL_PIXEL_PACK_BUFFER: return 4;
+	case GL_COPY_WRITE_BUFFER: return 5;
+	default: return -1;
+	}
+}
+
+bool GLStateCache::changed(StateCall call, unsigned int& shadow, unsigned int value) {
+	if (shadow == value) {
+		frameStats.elided[call]++;
+		return false;
+	}
+	shadow = value;
+	frameStats.issued[call]++;
+	return true;
+}
+
+void GLStateCache::useProgram(unsigned int shaderProgram) {
+	if (changed(STATE_PROGRAM, program, shaderProgram)) {
+		glUseProgram(shaderProgram);
+	}
+}
+
+void GLStateCache::bindVertexArray(unsigned int vao) {
+	if (changed(STATE_VERTEX_ARRAY, vertexArray, vao)) {
+		glBindVertexArray(vao);
+		// the element array binding is part of the VAO, so switching VAOs switches it too
+		buffers[1] = UNKNOWN;
+	}
+}
+
+void GLStateCache::bindTexture(unsigned int unit, GLenum target, unsigned int texture) {
+	int targetIndex = textureTargetIndex(target);
+	if (unit >= MAX_TEXTURE_UNITS || targetIndex < 0) {
+		// untracked, always forward
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		activeTextureUnit = unit;
+		frameStats.issued[STATE_ACTIVE_TEXTURE]++;
+		frameStats.issued[STATE_TEXTURE]++;
+		return;
+	}
+	if (!changed(STATE_TEXTURE, textures[unit][targetIndex], texture)) {
+		return;
+	}
+	if (changed(STATE_ACTIVE_TEXTURE, activeTextureUnit, unit)) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	glBindTexture(target, texture);
+}
+
+void GLStateCache::bindBuffer(GLenum target, unsigned int buffer) {
+	int targetIndex = bufferTargetIndex(target);
+	if (targetIndex < 0) {
+		glBindBuffer(target, buffer);
+		frameStats.issued[STATE_BUFFER]++;
+		return;
+	}
+	if (changed(STATE_BUFFER, buffers[targetIndex], buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+void GLStateCache::bindBufferBase(GLenum target, unsigned int index, unsigned int buffer) {
+	glBindBufferBase(target, index, buffer);
+	frameStats.issued[STATE_BUFFER]++;
+	int targetIndex = bufferTargetIndex(target);
+	if (targetIndex >= 0) {
+		buffers[targetIndex] = buffer;
+	}
+}
+
+void GLStateCache::bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size) {
+	glBindBufferRange(target, index, buffer, offset, size);
+	frameStats.issued[STATE_BUFFER]++;
+	int targetIndex = bufferTargetIndex(target);
+	if (targetIndex >= 0) {
+		buffers[targetIndex] = buffer;
+	}
+}
+
+void GLStateCache::polygonModeFrontAndBack(GLenum mode) {
+	if (changed(STATE_POLYGON_MODE, polygonMode, mode)) {
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+	}
+}
+
+void GLStateCache::setDepthTest(bool enabled) {
+	if (changed(STATE_DEPTH, depthTest, enabled ? 1 : 0)) {
+		if (enabled) {
+			glEnable(GL_DEPTH_TEST);
+		}
+		else {
+			glDisable(GL_DEPTH_TEST);
+		}
+	}
+}
+
+void GLStateCache::setDepthMask(bool enabled) {
+	if (changed(STATE_DEPTH, depthMask, enabled ? 1 : 0)) {
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::setDepthFunc(GLenum func) {
+	if (changed(STATE_DEPTH, depthFunc, func)) {
+		glDepthFunc(func);
+	}
+}
+
+void GLStateCache::forgetProgram(unsigned int shaderProgram) {
+	if (program == shaderProgram) {
+		program = UNKNOWN;
+	}
+}
+
+void GLStateCache::forgetBuffer(unsigned int buffer) {
+	for (int target = 0; target < BUFFER_TARGET_COUNT; target++) {
+		if (buffers[target] == buffer) {
+			buffers[target] = UNKNOWN;
+		}
+	}
+}
+
+void GLStateCache::forgetTexture(unsigned int texture) {
+	for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+		for (int target = 0; target < TEXTURE_TARGET_COUNT; target++) {
+			if (textures[unit][target] == texture) {
+				textures[unit][target] = UNKNOWN;
+			}
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <glad/glad.h>
+
+// Kinds of state change tracked by GLStateCache, used to index its counters.
+enum StateCall {
+	STATE_PROGRAM,
+	STATE_VERTEX_ARRAY,
+	STATE_ACTIVE_TEXTURE,
+	STATE_TEXTURE,
+	STATE_BUFFER,
+	STATE_POLYGON_MODE,
+	STATE_DEPTH,
+	STATE_CALL_COUNT
+};
+
+struct StateCacheStats {
+	unsigned int issued[STATE_CALL_COUNT];
+	unsigned int elided[STATE_CALL_COUNT];
+
+	unsigned int totalIssued() const;
+	unsigned int totalElided() const;
+	void reset();
+	void print(const char* label) const;
+};
+
+// Shadow copy of the GL state the renderer touches. Each wrapper only reaches the driver when the
+// requested value differs from what is already bound. Anything that changes this state behind the
+// cache's back (raw GL calls, other libraries) must be followed by invalidate().
+class GLStateCache {
+private:
+	static const int MAX_TEXTURE_UNITS = 16;
+	static const int TEXTURE_TARGET_COUNT = 3;
+	static const int BUFFER_TARGET_COUNT = 6;
+	static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int activeTextureUnit;
+	unsigned int textures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+	unsigned int buffers[BUFFER_TARGET_COUNT];
+	unsigned int polygonMode;
+	unsigned int depthTest;
+	unsigned int depthMask;
+	unsigned int depthFunc;
+
+	StateCacheStats frameStats;
+	StateCacheStats lastFrameStats;
+
+	static int textureTargetIndex(GLenum target);
+	static int bufferTargetIndex(GLenum target);
+	bool changed(StateCall call, unsigned int& shadow, unsigned int value);
+
+public:
+	GLStateCache();
+
+	// Forget everything so the next call of each kind reaches the driver.
+	void invalidate();
+	// Closes the counters of the frame that just finished and starts new ones.
+	void beginFrame();
+	const StateCacheStats& getFrameStats() const { return lastFrameStats; }
+	// The program bound through useProgram, 0 when none is or the cache has been invalidated since.
+	unsigned int getProgram() const { return program == UNKNOWN ? 0 : program; }
+
+	void useProgram(unsigned int shaderProgram);
+	void bindVertexArray(unsigned int vao);
+	void bindTexture(unsigned int unit, GLenum target, unsigned int texture);
+	void bindBuffer(GLenum target, unsigned int buffer);
+	// Indexed bindings aren't shadowed and always reach the driver, but they also replace the generic
+	// binding of target, which is.
+	void bindBufferBase(GLenum target, unsigned int index, unsigned int buffer);
+	void bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size);
+	void polygonModeFrontAndBack(GLenum mode);
+	void setDepthTest(bool enabled);
+	void setDepthMask(bool enabled);
+	void setDepthFunc(GLenum func);
+
+	// Called when a program, buffer or texture is deleted so a recycled name isn't mistaken for a bound one.
+	void forgetProgram(unsigned int shaderProgram);
+	void forgetBuffer(unsigned int buffer);
+	void forgetTexture(unsigned int texture);
+};
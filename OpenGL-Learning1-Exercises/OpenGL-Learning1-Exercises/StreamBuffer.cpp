@@ -0,0 +1,147 @@
+#include "StreamBuffer.h"
+#include "GLExtensions.h"
+#include <iostream>
+
+// the buffer is only ever bound here for (re)allocation and mapping, so the array/uniform
+// bindings used for drawing aren't disturbed
+static const GLenum STREAM_TARGET = GL_COPY_WRITE_BUFFER;
+
+void StreamBuffer::create(size_t bytesPerFrame) {
+	regionSize = bytesPerFrame;
+	size_t totalSize = regionSize * REGION_COUNT;
+
+	glGenBuffers(1, &buffer);
+	bindBuffer(buffer);
+
+	persistent = glExtensions.hasBufferStorage;
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glExtensions.bufferStorage(STREAM_TARGET, totalSize, NULL, flags);
+		persistentPointer = (unsigned char*)glMapBufferRange(STREAM_TARGET, 0, totalSize, flags);
+		if (!persistentPointer) {
+			std::cout << "ERROR::STREAM_BUFFER::PERSISTENT_MAP_FAILED, falling back to orphaning" << std::endl;
+			persistent = false;
+			deleteBuffer();
+			glGenBuffers(1, &buffer);
+			bindBuffer(buffer);
+		}
+	}
+	if (!persistent) {
+		glBufferData(STREAM_TARGET, totalSize, NULL, GL_STREAM_DRAW);
+	}
+	bindBuffer(0);
+
+	region = 0;
+	offset = 0;
+}
+
+void StreamBuffer::destroy() {
+	deleteFences();
+	if (persistentPointer) {
+		bindBuffer(buffer);
+		glUnmapBuffer(STREAM_TARGET);
+		bindBuffer(0);
+		persistentPointer = nullptr;
+	}
+	deleteBuffer();
+}
+
+void StreamBuffer::bindBuffer(unsigned int name) {
+	if (stateCache) {
+		stateCache->bindBuffer(STREAM_TARGET, name);
+	}
+	else {
+		glBindBuffer(STREAM_TARGET, name);
+	}
+}
+
+void StreamBuffer::deleteBuffer() {
+	if (stateCache) {
+		stateCache->forgetBuffer(buffer);
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void StreamBuffer::deleteFences() {
+	for (int i = 0; i < REGION_COUNT; i++) {
+		if (fences[i]) {
+			glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+	}
+}
+
+void* StreamBuffer::map(size_t size, size_t alignment, size_t& gpuOffset) {
+	size_t alignedOffset = (offset + alignment - 1) / alignment * alignment;
+	if (alignedOffset + size > regionSize) {
+		std::cout << "ERROR::STREAM_BUFFER::OUT_OF_SPACE requested " << size << " bytes" << std::endl;
+		return nullptr;
+	}
+	gpuOffset = region * regionSize + alignedOffset;
+
+	unsigned char* pointer;
+	if (persistent) {
+		pointer = persistentPointer + gpuOffset;
+	}
+	else {
+		// the region's fence already guarantees the GPU is done with this range
+		bindBuffer(buffer);
+		pointer = (unsigned char*)glMapBufferRange(STREAM_TARGET, gpuOffset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (!pointer) {
+			std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED for " << size << " bytes" << std::endl;
+			bindBuffer(0);
+			return nullptr;
+		}
+		mapped = true;
+	}
+	offset = alignedOffset + size;
+	frameStats.bytesStreamed += size;
+	return pointer;
+}
+
+void StreamBuffer::unmap() {
+	if (mapped) {
+		glUnmapBuffer(STREAM_TARGET);
+		bindBuffer(0);
+		mapped = false;
+	}
+}
+
+void StreamBuffer::waitForRegion(int index) {
+	if (!fences[index]) {
+		return;
+	}
+	GLenum status = glClientWaitSync(fences[index], 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		if (!persistent) {
+			// nothing is written in place on this path, so fresh storage is as good as waiting
+			bindBuffer(buffer);
+			glBufferData(STREAM_TARGET, regionSize * REGION_COUNT, NULL, GL_STREAM_DRAW);
+			bindBuffer(0);
+			deleteFences();
+			frameStats.orphans++;
+			return;
+		}
+		frameStats.stalls++;
+		do {
+			status = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fences[index]);
+	fences[index] = 0;
+}
+
+void StreamBuffer::endFrame() {
+	if (fences[region]) {
+		glDeleteSync(fences[region]);
+	}
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	region = (region + 1) % REGION_COUNT;
+	offset = 0;
+	waitForRegion(region);
+
+	lastFrameStats = frameStats;
+	frameStats = StreamBufferStats();
+}
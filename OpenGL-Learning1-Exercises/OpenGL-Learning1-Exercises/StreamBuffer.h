@@ -0,0 +1,60 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+#include "StateCache.h"
+
+struct StreamBufferStats {
+	size_t bytesStreamed = 0;
+	unsigned int stalls = 0;  // frames where the CPU had to wait for the GPU to release a region
+	unsigned int orphans = 0; // fallback path: storage orphaned instead of waiting
+};
+
+// Ring buffer for data that is rewritten every frame (instance transforms, uniform blocks).
+// The buffer is split into REGION_COUNT regions, one per frame in flight, and each region is
+// fenced when its frame ends. By the time the ring wraps around the GPU has normally finished
+// with it, so the CPU writes without any driver synchronisation.
+// With ARB_buffer_storage the whole buffer is mapped once, persistently and coherently. On plain
+// GL 3.3 each allocation is mapped unsynchronized, and a region that is still busy is handled by
+// orphaning the buffer instead of waiting.
+class StreamBuffer {
+private:
+	static const int REGION_COUNT = 3;
+
+	unsigned int buffer = 0;
+	size_t regionSize = 0;
+	int region = 0;
+	size_t offset = 0; // within the current region
+	bool persistent = false;
+	unsigned char* persistentPointer = nullptr;
+	bool mapped = false;
+	GLsync fences[REGION_COUNT] = {};
+
+	StreamBufferStats frameStats;
+	StreamBufferStats lastFrameStats;
+	GLStateCache* stateCache = nullptr;
+
+	void deleteFences();
+	void waitForRegion(int index);
+	void bindBuffer(unsigned int name);
+	void deleteBuffer();
+
+public:
+	void create(size_t bytesPerFrame);
+	void destroy();
+
+	// Reserves size bytes in the current frame's region and returns where to write them. The GPU sees
+	// the data at gpuOffset in getBuffer(). Returns nullptr when the frame's region is full
+	// or the range couldn't be mapped; callers then have to upload the data some other way.
+	void* map(size_t size, size_t alignment, size_t& gpuOffset);
+	void unmap();
+
+	// Fences the region written this frame and moves on to the next one.
+	void endFrame();
+
+	// When set, the buffer is bound through the state cache so it stays in sync.
+	void setStateCache(GLStateCache* cache) { stateCache = cache; }
+	unsigned int getBuffer() const { return buffer; }
+	bool isPersistent() const { return persistent; }
+	const StreamBufferStats& getFrameStats() const { return lastFrameStats; }
+};
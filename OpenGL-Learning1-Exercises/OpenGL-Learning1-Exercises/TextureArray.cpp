@@ -0,0 +1,72 @@
+#include "TextureArray.h"
+#include <iostream>
+
+#include "PixelFormat.h"
+
+TextureLayer TextureArrayManager::add(const unsigned char* pixels, int width, int height, int channels, GLenum internalFormat) {
+	if (arrays.empty()) {
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	}
+
+	unsigned int arrayIndex = 0;
+	while (arrayIndex < arrays.size()) {
+		const ArrayGroup& group = arrays[arrayIndex];
+		if (group.width == width && group.height == height && group.internalFormat == internalFormat
+			&& group.texture == 0 && (int)group.layerCount < maxLayers) {
+			break;
+		}
+		arrayIndex++;
+	}
+	if (arrayIndex == arrays.size()) {
+		ArrayGroup group;
+		group.width = width;
+		group.height = height;
+		group.internalFormat = internalFormat;
+		arrays.push_back(group);
+	}
+
+	ArrayGroup& group = arrays[arrayIndex];
+	PendingTexture texture;
+	texture.pixels.assign(pixels, pixels + (size_t)width * height * channels);
+	texture.format = formatForChannels(channels);
+	group.pending.push_back(std::move(texture));
+
+	TextureLayer result;
+	result.array = arrayIndex;
+	result.layer = group.layerCount++;
+	return result;
+}
+
+void TextureArrayManager::build(GLStateCache& stateCache) {
+	beginPackedRowUploads();
+	for (ArrayGroup& group : arrays) {
+		if (group.texture != 0) {
+			continue;
+		}
+		glGenTextures(1, &group.texture);
+		stateCache.bindTexture(0, GL_TEXTURE_2D_ARRAY, group.texture);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, group.internalFormat, group.width, group.height, group.layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		for (size_t layer = 0; layer < group.pending.size(); layer++) {
+			const PendingTexture& texture = group.pending[layer];
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (int)layer, group.width, group.height, 1, texture.format, GL_UNSIGNED_BYTE, texture.pixels.data());
+		}
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+		group.pending.clear();
+		group.pending.shrink_to_fit();
+	}
+	endPackedRowUploads();
+	stateCache.bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArrayManager::destroy() {
+	for (ArrayGroup& group : arrays) {
+		glDeleteTextures(1, &group.texture);
+	}
+	arrays.clear();
+}
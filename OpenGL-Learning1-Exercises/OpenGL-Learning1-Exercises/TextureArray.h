@@ -0,0 +1,46 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+#include "StateCache.h"
+
+// Where a texture ended up: which array and which layer of it.
+struct TextureLayer {
+	unsigned int array;
+	unsigned int layer;
+};
+
+// Packs textures that share width, height and internal format into GL_TEXTURE_2D_ARRAY layers.
+// Objects whose textures live in the same array only differ by a layer index, which the shader
+// reads per instance or per draw, so switching "material" no longer needs a texture rebind.
+// Textures are queued with add() and uploaded together by build(), since the layer count of an
+// array has to be known when its storage is allocated.
+class TextureArrayManager {
+private:
+	struct PendingTexture {
+		std::vector<unsigned char> pixels;
+		GLenum format;
+	};
+	struct ArrayGroup {
+		int width;
+		int height;
+		GLenum internalFormat;
+		unsigned int texture = 0;
+		unsigned int layerCount = 0;
+		std::vector<PendingTexture> pending; // released by build()
+	};
+
+	std::vector<ArrayGroup> arrays;
+	int maxLayers = 256;
+
+public:
+	// pixels are copied; channels selects GL_RED/RG/RGB/RGBA as the source format.
+	TextureLayer add(const unsigned char* pixels, int width, int height, int channels, GLenum internalFormat = GL_RGBA8);
+	void build(GLStateCache& stateCache);
+	void destroy();
+
+	unsigned int getTexture(unsigned int array) const { return arrays[array].texture; }
+	unsigned int getLayerCount(unsigned int array) const { return arrays[array].layerCount; }
+	size_t getArrayCount() const { return arrays.size(); }
+};
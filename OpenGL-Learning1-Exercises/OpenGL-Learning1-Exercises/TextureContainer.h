@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+// Layout of the block-compressed textures written by Tools/CookTextures and read by
+// loadCompressedTexture. It follows KTX2: the same identifier, header fields and level index, with
+// formats named by their VkFormat values. It leaves out the data format descriptor, key/value data and
+// supercompression, since vkFormat alone says everything the loader needs, so general KTX2 tools may
+// refuse the files. Levels are stored largest first, each at a 16-byte aligned offset, with rows
+// bottom-up the way glCompressedTexImage2D expects them. Shared by the runtime and the cooker, so
+// this header doesn't depend on GL.
+
+static const unsigned char TEXTURE_CONTAINER_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const unsigned int TEXTURE_CONTAINER_MAX_LEVELS = 16;
+static const size_t TEXTURE_CONTAINER_LEVEL_ALIGNMENT = 16;
+
+// VkFormat values of the block formats the cooker writes.
+enum TextureContainerFormat {
+	CONTAINER_FORMAT_BC1_RGB_UNORM = 131,
+	CONTAINER_FORMAT_BC1_RGB_SRGB = 132,
+	CONTAINER_FORMAT_BC3_UNORM = 137,
+	CONTAINER_FORMAT_BC3_SRGB = 138,
+	CONTAINER_FORMAT_BC4_UNORM = 139,
+	CONTAINER_FORMAT_BC5_UNORM = 141
+};
+
+struct TextureContainerHeader {
+	unsigned char identifier[12];
+	unsigned int vkFormat;
+	unsigned int typeSize; // 1 for block-compressed formats
+	unsigned int pixelWidth;
+	unsigned int pixelHeight;
+	unsigned int pixelDepth; // 0 for 2D textures
+	unsigned int layerCount; // 0 when not an array
+	unsigned int faceCount;
+	unsigned int levelCount;
+	unsigned int supercompressionScheme;
+	unsigned int dfdByteOffset;
+	unsigned int dfdByteLength;
+	unsigned int kvdByteOffset;
+	unsigned int kvdByteLength;
+	unsigned long long sgdByteOffset;
+	unsigned long long sgdByteLength;
+};
+static_assert(sizeof(TextureContainerHeader) == 80, "the level index has to follow at byte 80");
+
+// One per level, right after the header.
+struct TextureContainerLevel {
+	unsigned long long byteOffset;
+	unsigned long long byteLength;
+	unsigned long long uncompressedByteLength;
+};
+
+// Bytes per 4x4 block, 0 for formats the container doesn't use.
+inline unsigned int containerBlockBytes(unsigned int vkFormat) {
+	switch (vkFormat) {
+	case CONTAINER_FORMAT_BC1_RGB_UNORM:
+	case CONTAINER_FORMAT_BC1_RGB_SRGB:
+	case CONTAINER_FORMAT_BC4_UNORM:
+		return 8;
+	case CONTAINER_FORMAT_BC3_UNORM:
+	case CONTAINER_FORMAT_BC3_SRGB:
+	case CONTAINER_FORMAT_BC5_UNORM:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+inline size_t containerLevelBytes(unsigned int vkFormat, unsigned int width, unsigned int height) {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * containerBlockBytes(vkFormat);
+}
+
+inline bool isContainerIdentifier(const void* data) {
+	return memcmp(data, TEXTURE_CONTAINER_IDENTIFIER, sizeof(TEXTURE_CONTAINER_IDENTIFIER)) == 0;
+}
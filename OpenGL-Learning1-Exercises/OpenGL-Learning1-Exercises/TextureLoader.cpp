@@ -0,0 +1,196 @@
+#include "TextureLoader.h"
+#include <fstream>
+#include <iostream>
+
+#include "stb_image.h"
+#include "Timing.h"
+
+void TextureLoaderStats::print(const char* label, unsigned int workers) const {
+	std::cout << "TEXTURE_LOADER::" << label << " " << images << " images, " << failed << " failed, " << workers << " decode workers, "
+		<< fileBytes << " file bytes, " << decodedBytes << " decoded bytes, read " << readMs << " ms, decode " << decodeMs
+		<< " ms, mips " << mipMs << " ms, upload " << uploadMs << " ms, " << totalMs << " ms end to end" << std::endl;
+}
+
+TextureLoader::~TextureLoader() {
+	stop();
+}
+
+void TextureLoader::start(unsigned int workerCount) {
+	stop();
+	if (workerCount == 0) {
+		workerCount = std::thread::hardware_concurrency();
+	}
+	if (workerCount == 0) {
+		workerCount = 1;
+	}
+	running = true;
+	ioThread = std::thread(&TextureLoader::runIO, this);
+	for (unsigned int i = 0; i < workerCount; i++) {
+		workers.emplace_back(&TextureLoader::runWorker, this);
+	}
+}
+
+void TextureLoader::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	readQueued.notify_all();
+	decodeQueued.notify_all();
+	if (ioThread.joinable()) {
+		ioThread.join();
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+
+	// requests nobody waited for are dropped without their callbacks
+	for (std::deque<Job*>* queue : { &readQueue, &decodeQueue, &uploadQueue }) {
+		for (Job* job : *queue) {
+			stbi_image_free(job->pixels);
+			freeMips(job->image.mips);
+			delete job;
+		}
+		queue->clear();
+	}
+	outstanding = 0;
+}
+
+void TextureLoader::request(const std::string& path, int desiredChannels, bool flipVertically, UploadCallback upload, const MipSettings* mips) {
+	Job* job = new Job();
+	job->path = path;
+	job->desiredChannels = desiredChannels;
+	job->flipVertically = flipVertically;
+	job->generateMips = mips != nullptr;
+	if (mips) {
+		job->mipSettings = *mips;
+	}
+	job->upload = upload;
+	job->pixels = nullptr;
+	job->readOk = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (outstanding == 0) {
+			firstRequest = std::chrono::steady_clock::now();
+		}
+		outstanding++;
+		readQueue.push_back(job);
+	}
+	readQueued.notify_one();
+}
+
+void TextureLoader::runIO() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		readQueued.wait(lock, [this] { return !running || !readQueue.empty(); });
+		if (!running) {
+			return;
+		}
+		Job* job = readQueue.front();
+		readQueue.pop_front();
+		lock.unlock();
+
+		// the whole file in one read; decoding from memory keeps the workers off the disk
+		auto start = std::chrono::steady_clock::now();
+		std::ifstream file(job->path, std::ios::binary | std::ios::ate);
+		if (file) {
+			std::streamsize size = file.tellg();
+			file.seekg(0, std::ios::beg);
+			job->file.resize((size_t)size);
+			job->readOk = size > 0 && file.read((char*)job->file.data(), size);
+		}
+		double readMs = elapsedMs(start);
+
+		lock.lock();
+		stats.readMs += readMs;
+		stats.fileBytes += job->file.size();
+		decodeQueue.push_back(job);
+		decodeQueued.notify_one();
+	}
+}
+
+void TextureLoader::runWorker() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		decodeQueued.wait(lock, [this] { return !running || !decodeQueue.empty(); });
+		if (!running) {
+			return;
+		}
+		Job* job = decodeQueue.front();
+		decodeQueue.pop_front();
+		lock.unlock();
+
+		auto start = std::chrono::steady_clock::now();
+		int width = 0, height = 0, channels = 0;
+		if (job->readOk) {
+			stbi_set_flip_vertically_on_load_thread(job->flipVertically);
+			job->pixels = stbi_load_from_memory(job->file.data(), (int)job->file.size(), &width, &height, &channels, job->desiredChannels);
+		}
+		std::vector<unsigned char>().swap(job->file);
+		job->image.path = &job->path;
+		job->image.width = width;
+		job->image.height = height;
+		job->image.channels = job->desiredChannels ? job->desiredChannels : channels;
+		job->image.pixels = job->pixels;
+		double decodeMs = elapsedMs(start);
+
+		double mipMs = 0.0;
+		if (job->pixels && job->generateMips) {
+			start = std::chrono::steady_clock::now();
+			job->image.mips = generateMips(job->pixels, width, height, job->image.channels, MIP_PIXEL_UNORM8, job->mipSettings);
+			mipMs = elapsedMs(start);
+		}
+
+		lock.lock();
+		stats.decodeMs += decodeMs;
+		stats.mipMs += mipMs;
+		uploadQueue.push_back(job);
+		uploadQueued.notify_one();
+	}
+}
+
+void TextureLoader::uploadJob(Job* job) {
+	auto start = std::chrono::steady_clock::now();
+	job->upload(job->image);
+	double uploadMs = elapsedMs(start);
+	stbi_image_free(job->image.pixels);
+	freeMips(job->image.mips);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.images++;
+	stats.failed += job->pixels ? 0 : 1;
+	stats.decodedBytes += job->pixels ? (size_t)job->image.width * job->image.height * job->image.channels : 0;
+	stats.uploadMs += uploadMs;
+	if (--outstanding == 0) {
+		stats.totalMs += elapsedMs(firstRequest);
+	}
+	delete job;
+}
+
+unsigned int TextureLoader::upload() {
+	std::deque<Job*> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.swap(uploadQueue);
+	}
+	for (Job* job : ready) {
+		uploadJob(job);
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	return outstanding;
+}
+
+void TextureLoader::finish() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (outstanding > 0) {
+		uploadQueued.wait(lock, [this] { return !uploadQueue.empty(); });
+		std::deque<Job*> ready;
+		ready.swap(uploadQueue);
+		lock.unlock();
+		for (Job* job : ready) {
+			uploadJob(job);
+		}
+		lock.lock();
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MipGenerator.h"
+
+// A decoded image as stbi returns it, rows bottom-up when the request asked for a flip.
+struct DecodedImage {
+	const std::string* path;
+	int width;
+	int height;
+	int channels; // of pixels: the requested count, or the file's when 0 was requested
+	// null when the file couldn't be read or decoded. A callback that keeps the pixels, e.g. to hand them
+	// to a TextureUploader, sets this to null and frees them with stbi_image_free itself
+	unsigned char* pixels;
+	// levels 1 and down when the request asked for them, built by the worker that decoded the image.
+	// Whatever is left in here when the callback returns is freed, so a callback that keeps the levels
+	// takes them out of the vector
+	std::vector<MipLevel> mips;
+};
+
+struct TextureLoaderStats {
+	unsigned int images = 0;
+	unsigned int failed = 0;
+	size_t fileBytes = 0;
+	size_t decodedBytes = 0;
+	double readMs = 0.0;   // summed over the I/O thread
+	double decodeMs = 0.0; // summed over all workers, so more than the elapsed time when they overlap
+	double mipMs = 0.0;    // also on the workers
+	double uploadMs = 0.0; // in the GL thread's callbacks
+	double totalMs = 0.0;  // from the first request to the last upload
+
+	void print(const char* label, unsigned int workers) const;
+};
+
+// Three-stage image loading pipeline. One I/O thread reads whole files into memory, a pool of worker
+// threads decodes them with stbi_load_from_memory, and upload() hands finished images to their
+// callbacks on the thread that owns the GL context, which is the only stage allowed to touch GL.
+// The stages run concurrently, so the file reads of one image overlap the decoding of others and
+// decoding scales with the worker count. The flip setting is per request: each worker sets it with
+// stbi_set_flip_vertically_on_load_thread before decoding, so the process-wide flag doesn't matter.
+// Requests can also have the workers build the mip chain with generateMips, which keeps
+// glGenerateMipmap and its driver-defined filtering off the GL thread.
+class TextureLoader {
+public:
+	typedef std::function<void(DecodedImage&)> UploadCallback;
+
+private:
+	struct Job {
+		std::string path;
+		int desiredChannels;
+		bool flipVertically;
+		bool generateMips;
+		MipSettings mipSettings;
+		UploadCallback upload;
+		std::vector<unsigned char> file;
+		DecodedImage image;
+		unsigned char* pixels;
+		bool readOk;
+	};
+
+	std::thread ioThread;
+	std::vector<std::thread> workers;
+	std::mutex mutex; // guards everything below
+	std::condition_variable readQueued;
+	std::condition_variable decodeQueued;
+	std::condition_variable uploadQueued;
+	std::deque<Job*> readQueue;
+	std::deque<Job*> decodeQueue;
+	std::deque<Job*> uploadQueue;
+	unsigned int outstanding = 0; // requested and not uploaded yet
+	bool running = false;
+	TextureLoaderStats stats;
+	std::chrono::steady_clock::time_point firstRequest;
+
+	void runIO();
+	void runWorker();
+	void uploadJob(Job* job);
+
+public:
+	~TextureLoader();
+
+	// 0 workers uses one per hardware thread.
+	void start(unsigned int workerCount = 0);
+	void stop();
+
+	// Queues path for loading. desiredChannels is passed to stbi as it is. upload runs on the thread that
+	// calls upload() or finish(), with pixels that are freed when it returns unless it takes them. With
+	// mips, the image arrives with its mip chain generated with those settings.
+	void request(const std::string& path, int desiredChannels, bool flipVertically, UploadCallback upload, const MipSettings* mips = nullptr);
+	// Runs the callbacks of every image decoded so far without waiting for the rest. Returns how many
+	// requests are still in flight.
+	unsigned int upload();
+	// Blocks until every request has been uploaded.
+	void finish();
+
+	unsigned int getWorkerCount() const { return (unsigned int)workers.size(); }
+	const TextureLoaderStats& getStats() const { return stats; }
+	void resetStats() { stats = TextureLoaderStats(); }
+};
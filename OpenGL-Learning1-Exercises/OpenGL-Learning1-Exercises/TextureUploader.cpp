@@ -0,0 +1,286 @@
+#include "TextureUploader.h"
+#include "GLExtensions.h"
+#include <cstring>
+#include <iostream>
+
+#include "PixelFormat.h"
+
+static const GLenum UPLOAD_TARGET = GL_PIXEL_UNPACK_BUFFER;
+static const size_t UPLOAD_ALIGNMENT = 16;
+
+void TextureUploadStats::print(const char* label) const {
+	std::cout << "TEXTURE_UPLOAD::" << label << " " << uploads << " uploads, " << bytesUploaded << " bytes, " << deferred
+		<< " updates over budget, " << ringFull << " with the ring full, " << direct << " direct, " << stalls << " stalls" << std::endl;
+}
+
+void TextureUploader::create(size_t ringBytes, size_t bytesPerFrame) {
+	capacity = ringBytes;
+	budget = bytesPerFrame;
+
+	glGenBuffers(1, &buffer);
+	bindBuffer(buffer);
+
+	persistent = glExtensions.hasBufferStorage;
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glExtensions.bufferStorage(UPLOAD_TARGET, capacity, NULL, flags);
+		persistentPointer = (unsigned char*)glMapBufferRange(UPLOAD_TARGET, 0, capacity, flags);
+		if (!persistentPointer) {
+			std::cout << "ERROR::TEXTURE_UPLOADER::PERSISTENT_MAP_FAILED, mapping each upload instead" << std::endl;
+			persistent = false;
+			deleteBuffer();
+			glGenBuffers(1, &buffer);
+			bindBuffer(buffer);
+		}
+	}
+	if (!persistent) {
+		glBufferData(UPLOAD_TARGET, capacity, NULL, GL_STREAM_DRAW);
+	}
+	// a bound unpack buffer turns every other texture upload's pointer into an offset
+	bindBuffer(0);
+	head = tail = used = frameBytes = 0;
+}
+
+void TextureUploader::destroy() {
+	for (const PendingUpload& upload : pending) {
+		if (upload.release) {
+			upload.release(upload.pixels);
+		}
+	}
+	pending.clear();
+	for (const InFlightRange& range : inFlight) {
+		glDeleteSync(range.fence);
+	}
+	inFlight.clear();
+	if (persistentPointer) {
+		bindBuffer(buffer);
+		glUnmapBuffer(UPLOAD_TARGET);
+		bindBuffer(0);
+		persistentPointer = nullptr;
+	}
+	deleteBuffer();
+}
+
+void TextureUploader::bindTexture(unsigned int texture) {
+	if (stateCache) {
+		stateCache->bindTexture(0, GL_TEXTURE_2D, texture);
+	}
+	else {
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+}
+
+void TextureUploader::bindBuffer(unsigned int name) {
+	if (stateCache) {
+		stateCache->bindBuffer(UPLOAD_TARGET, name);
+	}
+	else {
+		glBindBuffer(UPLOAD_TARGET, name);
+	}
+}
+
+void TextureUploader::deleteBuffer() {
+	if (stateCache) {
+		stateCache->forgetBuffer(buffer);
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void TextureUploader::queue(unsigned int texture, GLenum internalFormat, int width, int height, int channels, unsigned char* pixels, void (*release)(void*), bool generateMipmap) {
+	queueLevel(texture, 0, internalFormat, width, height, channels, pixels, release);
+	pending.back().generateMipmap = generateMipmap;
+}
+
+void TextureUploader::queueLevel(unsigned int texture, int level, GLenum internalFormat, int width, int height, int channels, unsigned char* pixels, void (*release)(void*)) {
+	// storage exists from here on, so the texture can be bound and sampled before its pixels arrive
+	bindTexture(texture);
+	glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, formatForChannels(channels), GL_UNSIGNED_BYTE, NULL);
+
+	PendingUpload upload;
+	upload.texture = texture;
+	upload.level = level;
+	upload.width = width;
+	upload.height = height;
+	upload.channels = channels;
+	upload.generateMipmap = false;
+	upload.pixels = pixels;
+	upload.release = release;
+	pending.push_back(upload);
+}
+
+bool TextureUploader::allocate(size_t size, size_t& offset) {
+	size = (size + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT * UPLOAD_ALIGNMENT;
+	if (used == 0) {
+		head = tail = 0;
+	}
+	else if (head == tail) {
+		return false;
+	}
+
+	size_t taken;
+	if (head >= tail) {
+		// free space is [head, capacity) and, after wrapping, [0, tail)
+		if (capacity - head >= size) {
+			offset = head;
+			taken = size;
+		}
+		else if (tail >= size) {
+			// the end of the ring is skipped and comes free with this range
+			offset = 0;
+			taken = capacity - head + size;
+		}
+		else {
+			return false;
+		}
+	}
+	else if (tail - head >= size) {
+		offset = head;
+		taken = size;
+	}
+	else {
+		return false;
+	}
+	head = offset + size;
+	used += taken;
+	frameBytes += taken;
+	return true;
+}
+
+void TextureUploader::retire(bool wait) {
+	while (!inFlight.empty()) {
+		InFlightRange& range = inFlight.front();
+		GLenum status = glClientWaitSync(range.fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			if (!wait) {
+				return;
+			}
+			stats.stalls++;
+			do {
+				status = glClientWaitSync(range.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			} while (status == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(range.fence);
+		tail = range.end;
+		used -= range.bytes;
+		inFlight.pop_front();
+		if (wait) {
+			// one range is enough for the caller to try again
+			return;
+		}
+	}
+}
+
+void TextureUploader::fenceFrame() {
+	if (frameBytes == 0) {
+		return;
+	}
+	InFlightRange range;
+	range.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	range.end = head;
+	range.bytes = frameBytes;
+	inFlight.push_back(range);
+	frameBytes = 0;
+}
+
+bool TextureUploader::upload(const PendingUpload& upload) {
+	size_t size = (size_t)upload.width * upload.height * upload.channels;
+	size_t offset;
+	if (!allocate(size, offset)) {
+		return false;
+	}
+
+	bindBuffer(buffer);
+	if (persistent) {
+		memcpy(persistentPointer + offset, upload.pixels, size);
+	}
+	else {
+		// the range's fence already guarantees the GPU is done with it
+		void* destination = glMapBufferRange(UPLOAD_TARGET, offset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (!destination) {
+			// the range goes back with this update's fence; the pixels go straight from client memory
+			std::cout << "ERROR::TEXTURE_UPLOADER::MAP_FAILED for " << size << " bytes, uploading directly" << std::endl;
+			bindBuffer(0);
+			uploadDirect(upload);
+			return true;
+		}
+		memcpy(destination, upload.pixels, size);
+		glUnmapBuffer(UPLOAD_TARGET);
+	}
+	bindTexture(upload.texture);
+	glTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, 0, upload.width, upload.height, formatForChannels(upload.channels), GL_UNSIGNED_BYTE, (void*)offset);
+	bindBuffer(0);
+	if (upload.generateMipmap) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	if (upload.release) {
+		upload.release(upload.pixels);
+	}
+	stats.uploads++;
+	stats.bytesUploaded += size;
+	return true;
+}
+
+void TextureUploader::uploadDirect(const PendingUpload& upload) {
+	bindTexture(upload.texture);
+	glTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, 0, upload.width, upload.height, formatForChannels(upload.channels), GL_UNSIGNED_BYTE, upload.pixels);
+	if (upload.generateMipmap) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	if (upload.release) {
+		upload.release(upload.pixels);
+	}
+	stats.uploads++;
+	stats.direct++;
+	stats.bytesUploaded += (size_t)upload.width * upload.height * upload.channels;
+}
+
+size_t TextureUploader::update() {
+	retire(false);
+	if (pending.empty()) {
+		return 0;
+	}
+
+	beginPackedRowUploads();
+	size_t frameUploaded = 0;
+	while (!pending.empty()) {
+		const PendingUpload& next = pending.front();
+		size_t size = (size_t)next.width * next.height * next.channels;
+		// the first image of a frame always goes, so one larger than the budget can't block the queue
+		if (frameUploaded > 0 && frameUploaded + size > budget) {
+			stats.deferred++;
+			break;
+		}
+		if (size > capacity) {
+			uploadDirect(next);
+		}
+		else if (!upload(next)) {
+			stats.ringFull++;
+			break;
+		}
+		frameUploaded += size;
+		pending.pop_front();
+	}
+	endPackedRowUploads();
+	fenceFrame();
+	return pending.size();
+}
+
+void TextureUploader::flush() {
+	beginPackedRowUploads();
+	while (!pending.empty()) {
+		const PendingUpload& next = pending.front();
+		if ((size_t)next.width * next.height * next.channels > capacity) {
+			uploadDirect(next);
+		}
+		else if (!upload(next)) {
+			fenceFrame();
+			retire(true);
+			continue;
+		}
+		pending.pop_front();
+	}
+	endPackedRowUploads();
+	fenceFrame();
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <deque>
+
+#include "StateCache.h"
+
+struct TextureUploadStats {
+	size_t bytesUploaded = 0;
+	unsigned int uploads = 0;
+	unsigned int deferred = 0;  // updates that left uploads queued because of the byte budget
+	unsigned int ringFull = 0;  // updates that left uploads queued because the GPU still held the ring
+	unsigned int direct = 0;    // images larger than the whole ring, uploaded from client memory
+	unsigned int stalls = 0;    // flushes that had to wait for the GPU to release ring space
+
+	void print(const char* label) const;
+};
+
+// Streams the levels of 2D textures through a ring of GL_PIXEL_UNPACK_BUFFER memory, so glTexSubImage2D
+// reads from a buffer offset and returns without copying the pixels. The driver does that copy when the
+// GPU gets to it instead of stalling the frame that issued the upload.
+// Like StreamBuffer, the ring is mapped once, persistently, with ARB_buffer_storage, and each range is
+// mapped unsynchronized otherwise. Space is handed out in order and reclaimed through one fence per
+// update() that uploaded something, so nothing is overwritten before the GPU has read it.
+// update() is meant to be called once per frame and uploads at most bytesPerFrame, always at least one
+// image, so textures requested during gameplay stream in over several frames instead of spiking one.
+class TextureUploader {
+private:
+	struct PendingUpload {
+		unsigned int texture;
+		int level;
+		int width;
+		int height;
+		int channels;
+		bool generateMipmap;
+		unsigned char* pixels;
+		void (*release)(void*);
+	};
+	// a range of the ring handed out by one update, free again once the fence has signalled
+	struct InFlightRange {
+		GLsync fence;
+		size_t end;
+		size_t bytes; // including the space skipped when the range wrapped around
+	};
+
+	unsigned int buffer = 0;
+	size_t capacity = 0;
+	size_t budget = 0;
+	bool persistent = false;
+	unsigned char* persistentPointer = nullptr;
+	size_t head = 0;      // where the next range starts
+	size_t tail = 0;      // start of the oldest range still in flight
+	size_t used = 0;
+	size_t frameBytes = 0; // ring space taken by the current update, fenced at its end
+	std::deque<PendingUpload> pending;
+	std::deque<InFlightRange> inFlight;
+	TextureUploadStats stats;
+	GLStateCache* stateCache = nullptr;
+
+	bool allocate(size_t size, size_t& offset);
+	void retire(bool wait);
+	bool upload(const PendingUpload& upload);
+	void uploadDirect(const PendingUpload& upload);
+	void fenceFrame();
+	void bindTexture(unsigned int texture);
+	void bindBuffer(unsigned int name);
+	void deleteBuffer();
+
+public:
+	void create(size_t ringBytes, size_t bytesPerFrame);
+	void destroy();
+
+	// Allocates level 0 of texture with internalFormat right away and queues its pixels, which must
+	// stay valid until they have been copied into the ring; release, when not null, is then called
+	// with them. channels selects a GL_RED, GL_RG, GL_RGB or GL_RGBA source.
+	void queue(unsigned int texture, GLenum internalFormat, int width, int height, int channels, unsigned char* pixels, void (*release)(void*), bool generateMipmap = true);
+	// The same for one mip level, e.g. from generateMips, for textures queued without generateMipmap.
+	// Levels are uploaded in the order they are queued, like everything else.
+	void queueLevel(unsigned int texture, int level, GLenum internalFormat, int width, int height, int channels, unsigned char* pixels, void (*release)(void*));
+
+	// Uploads queued images within the per-frame budget. Returns how many are still queued.
+	size_t update();
+	// Uploads everything queued, waiting for ring space when it has to, e.g. behind a loading screen.
+	void flush();
+
+	// When set, textures (on unit 0) and the ring are bound through the state cache, so it stays in sync.
+	void setStateCache(GLStateCache* cache) { stateCache = cache; }
+	size_t getQueuedCount() const { return pending.size(); }
+	bool isPersistent() const { return persistent; }
+	const TextureUploadStats& getStats() const { return stats; }
+};
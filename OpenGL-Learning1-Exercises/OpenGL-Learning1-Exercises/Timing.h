@@ -0,0 +1,7 @@
+#pragma once
+#include <chrono>
+
+// Milliseconds since start on the steady clock, the unit every stats struct reports in.
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
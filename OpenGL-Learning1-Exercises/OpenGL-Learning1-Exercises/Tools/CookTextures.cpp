@@ -0,0 +1,545 @@
+// Cooks images into block-compressed textures with a full mip chain, in the container described in
+// TextureContainer.h. Run from the project directory:
+//
+//     CookTextures [--format auto|bc1|bc3|bc4|bc5] [--srgb] [--mips box|kaiser|lanczos]
+//                  [--alpha-coverage <cutoff>] Textures/*.jpg Textures/*.png
+//
+// Each image is written next to its source with a .ktx2 extension. auto picks BC1 for opaque colour,
+// BC3 when any alpha is below 255, BC4 for one channel and BC5 for two. Mips come from generateMips,
+// Kaiser filtered by default and in linear light with --srgb, and every level is compressed with the
+// encoders below, so the runtime has nothing left to decode, filter or compress. Files are cooked on
+// one thread per core. Build it together with ../MipGenerator.cpp.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+#include "../MipGenerator.h"
+#include "../TextureContainer.h"
+
+struct CookSettings {
+	std::string format = "auto";
+	bool srgb = false;
+	MipSettings mips;
+};
+
+struct Image {
+	int width;
+	int height;
+	std::vector<unsigned char> pixels; // RGBA
+};
+
+// ---------------------------------------------------------------------------------------------------
+// BC1 colour blocks
+
+static unsigned short packColor565(const float* color) {
+	int r = std::min(31, std::max(0, (int)std::lround(color[0] * 31.0f / 255.0f)));
+	int g = std::min(63, std::max(0, (int)std::lround(color[1] * 63.0f / 255.0f)));
+	int b = std::min(31, std::max(0, (int)std::lround(color[2] * 31.0f / 255.0f)));
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+// the 8-bit value every decoder expands a 565 colour to
+static void unpackColor565(unsigned short packed, int* color) {
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void colorPalette(unsigned short color0, unsigned short color1, int palette[4][3]) {
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	for (int channel = 0; channel < 3; channel++) {
+		palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+		palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+	}
+}
+
+// Picks the nearest palette entry for each texel; returns the summed squared error.
+static int chooseColorIndices(const unsigned char texels[16][4], const int palette[4][3], unsigned int& indices) {
+	int totalError = 0;
+	indices = 0;
+	for (int i = 0; i < 16; i++) {
+		int bestError = 1 << 30, best = 0;
+		for (int entry = 0; entry < 4; entry++) {
+			int dr = texels[i][0] - palette[entry][0];
+			int dg = texels[i][1] - palette[entry][1];
+			int db = texels[i][2] - palette[entry][2];
+			int error = dr * dr + dg * dg + db * db;
+			if (error < bestError) {
+				bestError = error;
+				best = entry;
+			}
+		}
+		indices |= (unsigned int)best << (2 * i);
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+// Encodes endpoints in four-colour mode, which needs color0 > color1, and returns the error.
+static int encodeColorEndpoints(const unsigned char texels[16][4], const float* endpoint0, const float* endpoint1, unsigned char* block) {
+	unsigned short color0 = packColor565(endpoint0);
+	unsigned short color1 = packColor565(endpoint1);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+	int palette[4][3];
+	colorPalette(color0, color1, palette);
+	unsigned int indices;
+	int error = chooseColorIndices(texels, palette, indices);
+	if (color0 == color1) {
+		// equal endpoints would select three-colour mode, where index 3 is black
+		indices = 0;
+	}
+	block[0] = color0 & 0xFF;
+	block[1] = color0 >> 8;
+	block[2] = color1 & 0xFF;
+	block[3] = color1 >> 8;
+	for (int i = 0; i < 4; i++) {
+		block[4 + i] = (unsigned char)(indices >> (8 * i));
+	}
+	return error;
+}
+
+// Endpoints from the extremes along the block's principal axis, then one least-squares refit of the
+// endpoints to the indices those chose. Whichever of the two errs less is kept.
+static void encodeBC1(const unsigned char texels[16][4], unsigned char* block) {
+	float mean[3] = {};
+	for (int i = 0; i < 16; i++) {
+		for (int channel = 0; channel < 3; channel++) {
+			mean[channel] += texels[i][channel] / 16.0f;
+		}
+	}
+	float covariance[6] = {};
+	for (int i = 0; i < 16; i++) {
+		float r = texels[i][0] - mean[0], g = texels[i][1] - mean[1], b = texels[i][2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+		if (length < 1e-6f) {
+			break;
+		}
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	int minIndex = 0, maxIndex = 0;
+	float minProjection = 1e30f, maxProjection = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float projection = texels[i][0] * axis[0] + texels[i][1] * axis[1] + texels[i][2] * axis[2];
+		if (projection < minProjection) {
+			minProjection = projection;
+			minIndex = i;
+		}
+		if (projection > maxProjection) {
+			maxProjection = projection;
+			maxIndex = i;
+		}
+	}
+	float endpoint0[3], endpoint1[3];
+	for (int channel = 0; channel < 3; channel++) {
+		endpoint0[channel] = texels[maxIndex][channel];
+		endpoint1[channel] = texels[minIndex][channel];
+	}
+	int error = encodeColorEndpoints(texels, endpoint0, endpoint1, block);
+	if (error == 0) {
+		return;
+	}
+
+	// texel i is approximated by a_i * endpoint0 + b_i * endpoint1 with weights from its index
+	static const float weights0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {}, bx[3] = {};
+	for (int i = 0; i < 16; i++) {
+		float a = weights0[(indices >> (2 * i)) & 3], b = 1.0f - a;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int channel = 0; channel < 3; channel++) {
+			ax[channel] += a * texels[i][channel];
+			bx[channel] += b * texels[i][channel];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f) {
+		return;
+	}
+	float refined0[3], refined1[3];
+	for (int channel = 0; channel < 3; channel++) {
+		refined0[channel] = std::min(255.0f, std::max(0.0f, (bb * ax[channel] - ab * bx[channel]) / determinant));
+		refined1[channel] = std::min(255.0f, std::max(0.0f, (aa * bx[channel] - ab * ax[channel]) / determinant));
+	}
+	unsigned char refinedBlock[8];
+	if (encodeColorEndpoints(texels, refined0, refined1, refinedBlock) < error) {
+		std::copy(refinedBlock, refinedBlock + 8, block);
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------
+// BC4 single-channel blocks, also BC3's alpha and both halves of BC5
+
+static void alphaPalette(int value0, int value1, int* palette) {
+	palette[0] = value0;
+	palette[1] = value1;
+	for (int i = 1; i < 7; i++) {
+		palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+	}
+}
+
+// Eight-value mode between the block's minimum and maximum.
+static void encodeBC4(const unsigned char* values, int stride, unsigned char* block) {
+	int minimum = 255, maximum = 0;
+	for (int i = 0; i < 16; i++) {
+		minimum = std::min(minimum, (int)values[i * stride]);
+		maximum = std::max(maximum, (int)values[i * stride]);
+	}
+	block[0] = (unsigned char)maximum;
+	block[1] = (unsigned char)minimum;
+	int palette[8];
+	alphaPalette(maximum, minimum, palette);
+
+	unsigned long long indices = 0;
+	if (maximum > minimum) {
+		for (int i = 0; i < 16; i++) {
+			int value = values[i * stride];
+			int best = 0, bestError = 256;
+			for (int entry = 0; entry < 8; entry++) {
+				int error = std::abs(value - palette[entry]);
+				if (error < bestError) {
+					bestError = error;
+					best = entry;
+				}
+			}
+			indices |= (unsigned long long)best << (3 * i);
+		}
+	}
+	for (int i = 0; i < 6; i++) {
+		block[2 + i] = (unsigned char)(indices >> (8 * i));
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------
+// decoding, only to report the error of what was written
+
+static void decodeBC1(const unsigned char* block, unsigned char texels[16][4]) {
+	unsigned short color0 = block[0] | (block[1] << 8), color1 = block[2] | (block[3] << 8);
+	int palette[4][3];
+	colorPalette(color0, color1, palette);
+	unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+	for (int i = 0; i < 16; i++) {
+		const int* color = palette[(indices >> (2 * i)) & 3];
+		texels[i][0] = (unsigned char)color[0];
+		texels[i][1] = (unsigned char)color[1];
+		texels[i][2] = (unsigned char)color[2];
+	}
+}
+
+static void decodeBC4(const unsigned char* block, unsigned char* values, int stride) {
+	int palette[8];
+	alphaPalette(block[0], block[1], palette);
+	unsigned long long indices = 0;
+	for (int i = 0; i < 6; i++) {
+		indices |= (unsigned long long)block[2 + i] << (8 * i);
+	}
+	for (int i = 0; i < 16; i++) {
+		values[i * stride] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------
+
+static const char* formatName(unsigned int vkFormat) {
+	switch (vkFormat) {
+	case CONTAINER_FORMAT_BC1_RGB_UNORM: return "BC1";
+	case CONTAINER_FORMAT_BC1_RGB_SRGB: return "BC1 sRGB";
+	case CONTAINER_FORMAT_BC3_UNORM: return "BC3";
+	case CONTAINER_FORMAT_BC3_SRGB: return "BC3 sRGB";
+	case CONTAINER_FORMAT_BC4_UNORM: return "BC4";
+	case CONTAINER_FORMAT_BC5_UNORM: return "BC5";
+	default: return "?";
+	}
+}
+
+static bool isBC1(unsigned int vkFormat) {
+	return vkFormat == CONTAINER_FORMAT_BC1_RGB_UNORM || vkFormat == CONTAINER_FORMAT_BC1_RGB_SRGB;
+}
+
+static bool isBC3(unsigned int vkFormat) {
+	return vkFormat == CONTAINER_FORMAT_BC3_UNORM || vkFormat == CONTAINER_FORMAT_BC3_SRGB;
+}
+
+// Compresses one level and adds the squared error of the channels the format keeps to squaredError.
+static std::vector<unsigned char> compressLevel(const Image& image, unsigned int vkFormat, double& squaredError) {
+	std::vector<unsigned char> blocks(containerLevelBytes(vkFormat, image.width, image.height));
+	unsigned int blockBytes = containerBlockBytes(vkFormat);
+	int blocksX = (image.width + 3) / 4;
+	int blocksY = (image.height + 3) / 4;
+	for (int by = 0; by < blocksY; by++) {
+		for (int bx = 0; bx < blocksX; bx++) {
+			// blocks hanging over the edge of small levels repeat the last row and column
+			unsigned char texels[16][4];
+			for (int i = 0; i < 16; i++) {
+				int x = std::min(bx * 4 + i % 4, image.width - 1);
+				int y = std::min(by * 4 + i / 4, image.height - 1);
+				std::copy_n(&image.pixels[((size_t)y * image.width + x) * 4], 4, texels[i]);
+			}
+
+			unsigned char* block = &blocks[((size_t)by * blocksX + bx) * blockBytes];
+			unsigned char decoded[16][4] = {};
+			int channels = 0;
+			if (isBC1(vkFormat)) {
+				encodeBC1(texels, block);
+				decodeBC1(block, decoded);
+				channels = 3;
+			}
+			else if (isBC3(vkFormat)) {
+				encodeBC4(&texels[0][3], 4, block);
+				encodeBC1(texels, block + 8);
+				decodeBC4(block, &decoded[0][3], 4);
+				decodeBC1(block + 8, decoded);
+				channels = 4;
+			}
+			else if (vkFormat == CONTAINER_FORMAT_BC4_UNORM) {
+				encodeBC4(&texels[0][0], 4, block);
+				decodeBC4(block, &decoded[0][0], 4);
+				channels = 1;
+			}
+			else {
+				encodeBC4(&texels[0][0], 4, block);
+				encodeBC4(&texels[0][1], 4, block + 8);
+				decodeBC4(block, &decoded[0][0], 4);
+				decodeBC4(block + 8, &decoded[0][1], 4);
+				channels = 2;
+			}
+
+			for (int i = 0; i < 16; i++) {
+				if (bx * 4 + i % 4 >= image.width || by * 4 + i / 4 >= image.height) {
+					continue;
+				}
+				for (int channel = 0; channel < channels; channel++) {
+					double difference = (double)texels[i][channel] - decoded[i][channel];
+					squaredError += difference * difference / channels;
+				}
+			}
+		}
+	}
+	return blocks;
+}
+
+static unsigned int chooseFormat(const std::string& requested, int channels, const Image& image, bool srgb) {
+	std::string format = requested;
+	if (format == "auto") {
+		if (channels == 1) {
+			format = "bc4";
+		}
+		else if (channels == 2) {
+			format = "bc5";
+		}
+		else {
+			bool opaque = true;
+			for (size_t i = 3; i < image.pixels.size() && opaque; i += 4) {
+				opaque = image.pixels[i] == 255;
+			}
+			format = opaque ? "bc1" : "bc3";
+		}
+	}
+	if (format == "bc1") {
+		return srgb ? CONTAINER_FORMAT_BC1_RGB_SRGB : CONTAINER_FORMAT_BC1_RGB_UNORM;
+	}
+	if (format == "bc3") {
+		return srgb ? CONTAINER_FORMAT_BC3_SRGB : CONTAINER_FORMAT_BC3_UNORM;
+	}
+	if (format == "bc4") {
+		return CONTAINER_FORMAT_BC4_UNORM;
+	}
+	if (format == "bc5") {
+		return CONTAINER_FORMAT_BC5_UNORM;
+	}
+	return 0;
+}
+
+static std::string outputPath(const std::string& input) {
+	size_t dot = input.find_last_of('.');
+	size_t slash = input.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+		return input + ".ktx2";
+	}
+	return input.substr(0, dot) + ".ktx2";
+}
+
+// Runs on the cooking threads, so everything it prints goes to report and is written out in order.
+static bool cook(const char* path, const CookSettings& settings, std::ostream& report) {
+	int width, height, channels;
+	unsigned char* pixels = stbi_load(path, &width, &height, &channels, 4);
+	if (!pixels) {
+		report << "ERROR::COOK_TEXTURES::FILE_NOT_SUCCESFULLY_READ " << path << " " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+	std::vector<Image> levels(1);
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].pixels.assign(pixels, pixels + (size_t)width * height * 4);
+	stbi_image_free(pixels);
+
+	unsigned int vkFormat = chooseFormat(settings.format, channels, levels[0], settings.srgb);
+	if (vkFormat == 0) {
+		report << "ERROR::COOK_TEXTURES::UNKNOWN_FORMAT " << settings.format << std::endl;
+		return false;
+	}
+	// always from RGBA; the channels the format drops are simply not encoded
+	std::vector<MipLevel> mips = generateMips(levels[0].pixels.data(), width, height, 4, MIP_PIXEL_UNORM8, settings.mips);
+	for (const MipLevel& mip : mips) {
+		if (levels.size() == TEXTURE_CONTAINER_MAX_LEVELS) {
+			break;
+		}
+		levels.emplace_back();
+		levels.back().width = mip.width;
+		levels.back().height = mip.height;
+		levels.back().pixels.assign(mip.pixels, mip.pixels + (size_t)mip.width * mip.height * 4);
+	}
+	freeMips(mips);
+
+	TextureContainerHeader header = {};
+	std::copy_n(TEXTURE_CONTAINER_IDENTIFIER, sizeof(TEXTURE_CONTAINER_IDENTIFIER), header.identifier);
+	header.vkFormat = vkFormat;
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.faceCount = 1;
+	header.levelCount = (unsigned int)levels.size();
+
+	std::vector<TextureContainerLevel> index(levels.size());
+	std::vector<std::vector<unsigned char>> data(levels.size());
+	size_t offset = sizeof(header) + index.size() * sizeof(TextureContainerLevel);
+	double baseError = 0.0;
+	size_t uncompressedBytes = 0;
+	for (size_t level = 0; level < levels.size(); level++) {
+		double squaredError = 0.0;
+		data[level] = compressLevel(levels[level], vkFormat, squaredError);
+		if (level == 0) {
+			baseError = squaredError;
+		}
+		offset = (offset + TEXTURE_CONTAINER_LEVEL_ALIGNMENT - 1) / TEXTURE_CONTAINER_LEVEL_ALIGNMENT * TEXTURE_CONTAINER_LEVEL_ALIGNMENT;
+		index[level].byteOffset = offset;
+		index[level].byteLength = data[level].size();
+		index[level].uncompressedByteLength = data[level].size();
+		offset += data[level].size();
+		uncompressedBytes += (size_t)levels[level].width * levels[level].height * std::min(channels, 4);
+	}
+
+	std::string output = outputPath(path);
+	std::ofstream file(output, std::ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)index.data(), index.size() * sizeof(TextureContainerLevel));
+	for (size_t level = 0; level < levels.size(); level++) {
+		std::vector<char> padding((size_t)index[level].byteOffset - (size_t)file.tellp(), 0);
+		file.write(padding.data(), padding.size());
+		file.write((const char*)data[level].data(), data[level].size());
+	}
+	if (!file) {
+		report << "ERROR::COOK_TEXTURES::WRITE_FAILED " << output << std::endl;
+		return false;
+	}
+	double rmse = std::sqrt(baseError / ((double)width * height));
+	report << "COOK_TEXTURES " << path << " -> " << output << " " << formatName(vkFormat) << " " << width << "x" << height << ", "
+		<< levels.size() << " levels, " << offset << " bytes instead of " << uncompressedBytes << ", level 0 RMSE " << rmse << std::endl;
+	return true;
+}
+
+static bool parseMipFilter(const std::string& name, MipFilter& filter) {
+	if (name == "box") {
+		filter = MIP_FILTER_BOX;
+	}
+	else if (name == "kaiser") {
+		filter = MIP_FILTER_KAISER;
+	}
+	else if (name == "lanczos") {
+		filter = MIP_FILTER_LANCZOS;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	CookSettings settings;
+	settings.mips.filter = MIP_FILTER_KAISER;
+	std::vector<const char*> paths;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--format" && i + 1 < argc) {
+			settings.format = argv[++i];
+		}
+		else if (argument == "--srgb") {
+			settings.srgb = true;
+		}
+		else if (argument == "--mips" && i + 1 < argc) {
+			if (!parseMipFilter(argv[++i], settings.mips.filter)) {
+				std::cout << "ERROR::COOK_TEXTURES::UNKNOWN_MIP_FILTER " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else if (argument == "--alpha-coverage" && i + 1 < argc) {
+			settings.mips.preserveAlphaCoverage = true;
+			settings.mips.alphaCutoff = (float)atof(argv[++i]);
+		}
+		else {
+			paths.push_back(argv[i]);
+		}
+	}
+	if (paths.empty()) {
+		std::cout << "usage: CookTextures [--format auto|bc1|bc3|bc4|bc5] [--srgb] [--mips box|kaiser|lanczos] [--alpha-coverage <cutoff>] <images...>" << std::endl;
+		return 1;
+	}
+	settings.mips.srgb = settings.srgb;
+	// bottom row first, like everything else the renderer uploads
+	stbi_set_flip_vertically_on_load(true);
+
+	// each thread takes the next file until none are left
+	std::vector<std::ostringstream> reports(paths.size());
+	std::vector<char> succeeded(paths.size(), 0);
+	std::atomic<size_t> next(0);
+	auto cookFiles = [&]() {
+		for (size_t i = next++; i < paths.size(); i = next++) {
+			succeeded[i] = cook(paths[i], settings, reports[i]);
+		}
+	};
+	unsigned int threadCount = std::max(1u, std::min(std::thread::hardware_concurrency(), (unsigned int)paths.size()));
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++) {
+		threads.emplace_back(cookFiles);
+	}
+	cookFiles();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	int failed = 0;
+	for (size_t i = 0; i < paths.size(); i++) {
+		std::cout << reports[i].str();
+		failed += succeeded[i] ? 0 : 1;
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+// Bakes shader sources into a header so a build with EMBEDDED_SHADERS defined reads no shader files.
+// Run from the project directory so the stored paths match the ones the renderer asks for:
+//
+//     EmbedShaders EmbeddedShaders.h Shaders
+//
+// Directories are expanded here, recursively, since cmd.exe passes wildcards through unexpanded.
+// Paths are stored the way the preprocessor normalizes them (see ShaderPath.h), '/' separated.
+// Each file becomes a char array plus its FNV-1a hash, computed with the same function the runtime
+// uses, so the preprocessor and the program binary cache never have to hash embedded text at startup.
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../Hash.h"
+#include "../ShaderPath.h"
+
+struct ShaderFile {
+	std::string path; // as given or found, to read the file through
+	std::string name; // normalized, as the preprocessor will ask for it
+};
+
+// Files named on the command line, and every file under the directories named, in a stable order.
+static bool collectFiles(int argc, char** argv, std::vector<ShaderFile>& files) {
+	std::vector<std::string> paths;
+	for (int i = 2; i < argc; i++) {
+		std::error_code error;
+		if (std::filesystem::is_directory(argv[i], error)) {
+			std::vector<std::string> found;
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[i], error)) {
+				if (entry.is_regular_file()) {
+					found.push_back(entry.path().string());
+				}
+			}
+			if (error) {
+				std::cout << "ERROR::EMBED_SHADERS::DIRECTORY_NOT_READ " << argv[i] << std::endl;
+				return false;
+			}
+			std::sort(found.begin(), found.end());
+			paths.insert(paths.end(), found.begin(), found.end());
+		}
+		else {
+			paths.push_back(argv[i]);
+		}
+	}
+	// a file named twice, or also reached through its directory, is embedded once
+	for (const std::string& path : paths) {
+		ShaderFile file;
+		file.path = path;
+		file.name = normalizePath(path);
+		bool seen = std::any_of(files.begin(), files.end(), [&file](const ShaderFile& other) { return other.name == file.name; });
+		if (!seen) {
+			files.push_back(file);
+		}
+	}
+	return true;
+}
+
+// The path as a C string literal body: quotes, backslashes and anything unprintable escaped.
+static std::string escapeLiteral(const std::string& text) {
+	std::string escaped;
+	for (unsigned char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+			escaped += (char)c;
+		}
+		else if (c < 0x20 || c >= 0x7F || c == '?') {
+			// octal, always three digits so a following digit can't extend it; '?' because of trigraphs
+			char octal[8];
+			snprintf(octal, sizeof(octal), "\\%03o", c);
+			escaped += octal;
+		}
+		else {
+			escaped += (char)c;
+		}
+	}
+	return escaped;
+}
+
+static bool readFile(const std::string& path, std::string& contents) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	contents = stream.str();
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cout << "usage: EmbedShaders <output.h> <shader files or directories...>" << std::endl;
+		return 1;
+	}
+
+	std::ostringstream header;
+	header << "#pragma once\n";
+	header << "// Generated by Tools/EmbedShaders. Do not edit.\n";
+	header << "#include <cstddef>\n\n";
+	header << "struct EmbeddedShader {\n";
+	header << "\tconst char* path;\n";
+	header << "\tconst char* data;\n";
+	header << "\tsize_t size;\n";
+	header << "\tunsigned long long hash;\n";
+	header << "};\n\n";
+
+	std::vector<ShaderFile> files;
+	if (!collectFiles(argc, argv, files)) {
+		return 1;
+	}
+	std::vector<std::string> entries;
+	for (size_t i = 0; i < files.size(); i++) {
+		std::string contents;
+		if (!readFile(files[i].path, contents)) {
+			std::cout << "ERROR::EMBED_SHADERS::FILE_NOT_SUCCESFULLY_READ " << files[i].path << std::endl;
+			return 1;
+		}
+
+		// written as numbers rather than a string literal, so no escaping and no literal length limits;
+		// the trailing zero is not counted in size
+		std::string name = "embeddedShader" + std::to_string(i);
+		header << "// " << escapeLiteral(files[i].name) << "\n";
+		header << "static constexpr char " << name << "[] = {";
+		for (size_t c = 0; c < contents.size(); c++) {
+			header << (c % 24 == 0 ? "\n\t" : " ") << (int)(signed char)contents[c] << ",";
+		}
+		header << "\n\t0\n};\n\n";
+
+		std::ostringstream entry;
+		entry << "\t{ \"" << escapeLiteral(files[i].name) << "\", " << name << ", " << contents.size() << ", "
+			<< hashBytes(FNV_OFFSET_BASIS, contents.data(), contents.size()) << "ull },\n";
+		entries.push_back(entry.str());
+	}
+
+	header << "static constexpr EmbeddedShader embeddedShaders[] = {\n";
+	for (const std::string& entry : entries) {
+		header << entry;
+	}
+	header << "};\n";
+
+	std::ofstream output(argv[1], std::ios::binary);
+	output << header.str();
+	if (!output) {
+		std::cout << "ERROR::EMBED_SHADERS::WRITE_FAILED " << argv[1] << std::endl;
+		return 1;
+	}
+	std::cout << "EMBED_SHADERS " << entries.size() << " files -> " << argv[1] << std::endl;
+	return 0;
+}
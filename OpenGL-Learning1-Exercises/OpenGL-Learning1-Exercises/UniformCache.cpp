@@ -0,0 +1,282 @@
+#include "UniformCache.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+enum UniformComponent {
+	COMPONENT_FLOAT,
+	COMPONENT_INT, // ints, bools and samplers are all set through glUniform*i
+	COMPONENT_UINT
+};
+
+struct UniformTypeInfo {
+	GLenum type;
+	UniformComponent component;
+	int components;
+	GLenum intType; // the int type a bool type is set with, 0 for everything else
+};
+
+static const UniformTypeInfo uniformTypes[] = {
+	{ GL_FLOAT, COMPONENT_FLOAT, 1, 0 },
+	{ GL_FLOAT_VEC2, COMPONENT_FLOAT, 2, 0 },
+	{ GL_FLOAT_VEC3, COMPONENT_FLOAT, 3, 0 },
+	{ GL_FLOAT_VEC4, COMPONENT_FLOAT, 4, 0 },
+	{ GL_INT, COMPONENT_INT, 1, 0 },
+	{ GL_INT_VEC2, COMPONENT_INT, 2, 0 },
+	{ GL_INT_VEC3, COMPONENT_INT, 3, 0 },
+	{ GL_INT_VEC4, COMPONENT_INT, 4, 0 },
+	{ GL_UNSIGNED_INT, COMPONENT_UINT, 1, 0 },
+	{ GL_UNSIGNED_INT_VEC2, COMPONENT_UINT, 2, 0 },
+	{ GL_UNSIGNED_INT_VEC3, COMPONENT_UINT, 3, 0 },
+	{ GL_UNSIGNED_INT_VEC4, COMPONENT_UINT, 4, 0 },
+	{ GL_BOOL, COMPONENT_INT, 1, GL_INT },
+	{ GL_BOOL_VEC2, COMPONENT_INT, 2, GL_INT_VEC2 },
+	{ GL_BOOL_VEC3, COMPONENT_INT, 3, GL_INT_VEC3 },
+	{ GL_BOOL_VEC4, COMPONENT_INT, 4, GL_INT_VEC4 },
+	{ GL_FLOAT_MAT2, COMPONENT_FLOAT, 4, 0 },
+	{ GL_FLOAT_MAT3, COMPONENT_FLOAT, 9, 0 },
+	{ GL_FLOAT_MAT4, COMPONENT_FLOAT, 16, 0 },
+	{ GL_FLOAT_MAT2x3, COMPONENT_FLOAT, 6, 0 },
+	{ GL_FLOAT_MAT2x4, COMPONENT_FLOAT, 8, 0 },
+	{ GL_FLOAT_MAT3x2, COMPONENT_FLOAT, 6, 0 },
+	{ GL_FLOAT_MAT3x4, COMPONENT_FLOAT, 12, 0 },
+	{ GL_FLOAT_MAT4x2, COMPONENT_FLOAT, 8, 0 },
+	{ GL_FLOAT_MAT4x3, COMPONENT_FLOAT, 12, 0 },
+};
+
+// every type a 3.3 core default block can hold that isn't in the table is a sampler
+static const UniformTypeInfo samplerType = { GL_INT, COMPONENT_INT, 1, GL_INT };
+
+static const UniformTypeInfo& getTypeInfo(GLenum type) {
+	for (const UniformTypeInfo& info : uniformTypes) {
+		if (info.type == type) {
+			return info;
+		}
+	}
+	return samplerType;
+}
+
+static void uploadValues(GLenum type, int location, int count, const void* values) {
+	const float* f = (const float*)values;
+	const int* i = (const int*)values;
+	const unsigned int* u = (const unsigned int*)values;
+	switch (type) {
+	case GL_FLOAT: glUniform1fv(location, count, f); break;
+	case GL_FLOAT_VEC2: glUniform2fv(location, count, f); break;
+	case GL_FLOAT_VEC3: glUniform3fv(location, count, f); break;
+	case GL_FLOAT_VEC4: glUniform4fv(location, count, f); break;
+	case GL_INT_VEC2: case GL_BOOL_VEC2: glUniform2iv(location, count, i); break;
+	case GL_INT_VEC3: case GL_BOOL_VEC3: glUniform3iv(location, count, i); break;
+	case GL_INT_VEC4: case GL_BOOL_VEC4: glUniform4iv(location, count, i); break;
+	case GL_UNSIGNED_INT: glUniform1uiv(location, count, u); break;
+	case GL_UNSIGNED_INT_VEC2: glUniform2uiv(location, count, u); break;
+	case GL_UNSIGNED_INT_VEC3: glUniform3uiv(location, count, u); break;
+	case GL_UNSIGNED_INT_VEC4: glUniform4uiv(location, count, u); break;
+	case GL_FLOAT_MAT2: glUniformMatrix2fv(location, count, GL_FALSE, f); break;
+	case GL_FLOAT_MAT3: glUniformMatrix3fv(location, count, GL_FALSE, f); break;
+	case GL_FLOAT_MAT4: glUniformMatrix4fv(location, count, GL_FALSE, f); break;
+	case GL_FLOAT_MAT2x3: glUniformMatrix2x3fv(location, count, GL_FALSE, f); break;
+	case GL_FLOAT_MAT2x4: glUniformMatrix2x4fv(location, count, GL_FALSE, f); break;
+	case GL_FLOAT_MAT3x2: glUniformMatrix3x2fv(location, count, GL_FALSE, f); break;
+	case GL_FLOAT_MAT3x4: glUniformMatrix3x4fv(location, count, GL_FALSE, f); break;
+	case GL_FLOAT_MAT4x2: glUniformMatrix4x2fv(location, count, GL_FALSE, f); break;
+	case GL_FLOAT_MAT4x3: glUniformMatrix4x3fv(location, count, GL_FALSE, f); break;
+	default: glUniform1iv(location, count, i); break; // int, bool and samplers
+	}
+}
+
+void UniformUploadStats::print(const char* label) const {
+	std::cout << "UNIFORMS::" << label << " " << sets << " set, " << uploads << " uploaded, " << elided << " elided" << std::endl;
+}
+
+unsigned int UniformCache::hashName(const char* name, size_t length) {
+	// FNV-1a, uniform names are short so this is cheaper than anything fancier
+	unsigned int hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void UniformCache::insert(int index) {
+	unsigned int slot = uniforms[index].hash & slotMask;
+	while (slots[slot] != 0) {
+		slot = (slot + 1) & slotMask;
+	}
+	slots[slot] = index + 1;
+}
+
+void UniformCache::build(unsigned int shaderProgram) {
+	clear();
+
+	int uniformCount = 0;
+	int maxNameLength = 0;
+	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> nameBuffer(maxNameLength + 1);
+	for (int i = 0; i < uniformCount; i++) {
+		UniformInfo info;
+		int nameLength = 0;
+		glGetActiveUniform(shaderProgram, i, (int)nameBuffer.size(), &nameLength, &info.size, &info.type, nameBuffer.data());
+		info.name.assign(nameBuffer.data(), nameLength);
+		// uniforms inside a block have no location and are set through the block's buffer instead
+		info.location = glGetUniformLocation(shaderProgram, info.name.c_str());
+		if (info.location < 0) {
+			continue;
+		}
+
+		// arrays are reported as "name[0]", but callers address them by their plain name
+		size_t bracket = info.name.find('[');
+		if (bracket != std::string::npos) {
+			info.name.resize(bracket);
+		}
+		info.hash = hashName(info.name.c_str(), info.name.size());
+		info.elementBytes = getTypeInfo(info.type).components * 4;
+		info.offset = (int)shadow.size();
+		info.firstLocation = (int)locations.size();
+		info.dirtyBegin = 0;
+		info.dirtyEnd = 0;
+		info.typeMismatchReported = false;
+
+		locations.push_back(info.location);
+		for (int element = 1; element < info.size; element++) {
+			std::string elementName = info.name + "[" + std::to_string(element) + "]";
+			locations.push_back(glGetUniformLocation(shaderProgram, elementName.c_str()));
+		}
+		shadow.resize(shadow.size() + info.elementBytes * info.size);
+		readInitialValues(shaderProgram, info);
+		uniforms.push_back(info);
+	}
+	uploaded = shadow;
+
+	// keep the load factor at or below 50% so probe sequences stay short
+	unsigned int slotCount = 8;
+	while (slotCount < uniforms.size() * 2) {
+		slotCount <<= 1;
+	}
+	slots.assign(slotCount, 0);
+	slotMask = slotCount - 1;
+	for (int i = 0; i < (int)uniforms.size(); i++) {
+		insert(i);
+	}
+}
+
+void UniformCache::readInitialValues(unsigned int shaderProgram, const UniformInfo& info) {
+	// a linked program's uniforms start at zero or at their initializer; reading them back means the
+	// first write of the same value is elided like any other
+	UniformComponent component = getTypeInfo(info.type).component;
+	for (int element = 0; element < info.size; element++) {
+		int location = locations[info.firstLocation + element];
+		void* value = &shadow[info.offset + element * info.elementBytes];
+		if (location < 0) {
+			continue;
+		}
+		if (component == COMPONENT_FLOAT) {
+			glGetUniformfv(shaderProgram, location, (float*)value);
+		}
+		else if (component == COMPONENT_UINT) {
+			glGetUniformuiv(shaderProgram, location, (unsigned int*)value);
+		}
+		else {
+			glGetUniformiv(shaderProgram, location, (int*)value);
+		}
+	}
+}
+
+void UniformCache::clear() {
+	uniforms.clear();
+	slots.clear();
+	slotMask = 0;
+	locations.clear();
+	shadow.clear();
+	uploaded.clear();
+	dirty.clear();
+}
+
+void UniformCache::write(int handle, GLenum valueType, const void* values, int firstElement, int count, UniformUploadStats& stats) {
+	if (handle == INVALID_HANDLE) {
+		return;
+	}
+	UniformInfo& info = uniforms[handle];
+	const UniformTypeInfo& typeInfo = getTypeInfo(info.type);
+	if (valueType != info.type && valueType != typeInfo.intType) {
+		if (!info.typeMismatchReported) {
+			std::cout << "ERROR::UNIFORM::TYPE_MISMATCH " << info.name << " is 0x" << std::hex << info.type
+				<< ", set with 0x" << valueType << std::dec << std::endl;
+			info.typeMismatchReported = true;
+		}
+		return;
+	}
+	if (firstElement < 0 || firstElement >= info.size) {
+		return;
+	}
+	if (count > info.size - firstElement) {
+		count = info.size - firstElement;
+	}
+
+	unsigned char* target = &shadow[info.offset + firstElement * info.elementBytes];
+	size_t bytes = (size_t)count * info.elementBytes;
+	if (memcmp(target, values, bytes) == 0) {
+		stats.elided++;
+		return;
+	}
+	memcpy(target, values, bytes);
+	stats.sets++;
+
+	if (info.dirtyBegin == info.dirtyEnd) {
+		info.dirtyBegin = firstElement;
+		info.dirtyEnd = firstElement + count;
+		dirty.push_back(handle);
+	}
+	else {
+		info.dirtyBegin = std::min(info.dirtyBegin, firstElement);
+		info.dirtyEnd = std::max(info.dirtyEnd, firstElement + count);
+	}
+}
+
+void UniformCache::flush(UniformUploadStats& stats) {
+	for (int handle : dirty) {
+		UniformInfo& info = uniforms[handle];
+		// narrow the range to the elements that really differ; a value set and set back before the
+		// draw ends up with nothing to upload
+		int begin = info.dirtyBegin;
+		int end = info.dirtyEnd;
+		while (begin < end && memcmp(&shadow[info.offset + begin * info.elementBytes], &uploaded[info.offset + begin * info.elementBytes], info.elementBytes) == 0) {
+			begin++;
+		}
+		while (end > begin && memcmp(&shadow[info.offset + (end - 1) * info.elementBytes], &uploaded[info.offset + (end - 1) * info.elementBytes], info.elementBytes) == 0) {
+			end--;
+		}
+		info.dirtyBegin = 0;
+		info.dirtyEnd = 0;
+		if (begin == end) {
+			stats.elided++;
+			continue;
+		}
+
+		const unsigned char* values = &shadow[info.offset + begin * info.elementBytes];
+		uploadValues(info.type, locations[info.firstLocation + begin], end - begin, values);
+		memcpy(&uploaded[info.offset + begin * info.elementBytes], values, (size_t)(end - begin) * info.elementBytes);
+		stats.uploads++;
+	}
+	dirty.clear();
+}
+
+int UniformCache::find(const char* name) const {
+	if (slots.empty()) {
+		return INVALID_HANDLE;
+	}
+	size_t length = strlen(name);
+	unsigned int hash = hashName(name, length);
+	unsigned int slot = hash & slotMask;
+	while (slots[slot] != 0) {
+		const UniformInfo& info = uniforms[slots[slot] - 1];
+		if (info.hash == hash && info.name.size() == length && memcmp(info.name.c_str(), name, length) == 0) {
+			return slots[slot] - 1;
+		}
+		slot = (slot + 1) & slotMask;
+	}
+	return INVALID_HANDLE;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+struct UniformInfo {
+	std::string name;
+	unsigned int hash;
+	int location;
+	GLenum type;
+	int size; // array length, 1 for non-arrays
+	int elementBytes;
+	int offset; // into the shadow and uploaded blocks
+	int firstLocation; // index of element 0's location in the per-element location list
+	int dirtyBegin; // element range written since the last flush, empty when dirtyBegin == dirtyEnd
+	int dirtyEnd;
+	bool typeMismatchReported;
+};
+
+struct UniformUploadStats {
+	unsigned int sets = 0;     // set calls that changed the shadow value
+	unsigned int uploads = 0;  // glUniform* calls issued by flushes
+	unsigned int elided = 0;   // set calls and dirty ranges that matched what was already there
+	void print(const char* label) const;
+};
+
+// GL type of each C++ value type setUniform accepts. int also sets samplers and bools.
+template<typename T> struct UniformValueType;
+template<> struct UniformValueType<float> { static const GLenum value = GL_FLOAT; };
+template<> struct UniformValueType<glm::vec2> { static const GLenum value = GL_FLOAT_VEC2; };
+template<> struct UniformValueType<glm::vec3> { static const GLenum value = GL_FLOAT_VEC3; };
+template<> struct UniformValueType<glm::vec4> { static const GLenum value = GL_FLOAT_VEC4; };
+template<> struct UniformValueType<int> { static const GLenum value = GL_INT; };
+template<> struct UniformValueType<glm::ivec2> { static const GLenum value = GL_INT_VEC2; };
+template<> struct UniformValueType<glm::ivec3> { static const GLenum value = GL_INT_VEC3; };
+template<> struct UniformValueType<glm::ivec4> { static const GLenum value = GL_INT_VEC4; };
+template<> struct UniformValueType<unsigned int> { static const GLenum value = GL_UNSIGNED_INT; };
+template<> struct UniformValueType<glm::uvec2> { static const GLenum value = GL_UNSIGNED_INT_VEC2; };
+template<> struct UniformValueType<glm::uvec3> { static const GLenum value = GL_UNSIGNED_INT_VEC3; };
+template<> struct UniformValueType<glm::uvec4> { static const GLenum value = GL_UNSIGNED_INT_VEC4; };
+template<> struct UniformValueType<glm::mat2> { static const GLenum value = GL_FLOAT_MAT2; };
+template<> struct UniformValueType<glm::mat3> { static const GLenum value = GL_FLOAT_MAT3; };
+template<> struct UniformValueType<glm::mat4> { static const GLenum value = GL_FLOAT_MAT4; };
+
+// Snapshot of a linked program's active uniforms, taken once at link time. Names are looked up in a
+// small open-addressing hash table so nothing has to ask the driver for a location after startup.
+// Handles are indices into the uniform list and stay valid for the lifetime of the program.
+//
+// Values are not sent to GL when they are set. write() stores them in a CPU shadow block and marks
+// the element range dirty; flush() uploads the dirty ranges that differ from what the program holds,
+// which is tracked in a second block read back from the program at link time.
+class UniformCache {
+private:
+	std::vector<UniformInfo> uniforms;
+	std::vector<int> slots; // uniform index + 1, 0 marks an empty slot
+	unsigned int slotMask = 0;
+	std::vector<int> locations; // per array element, arrays don't promise consecutive locations
+	std::vector<unsigned char> shadow;
+	std::vector<unsigned char> uploaded;
+	std::vector<int> dirty; // handles with a non-empty dirty range
+
+	static unsigned int hashName(const char* name, size_t length);
+	void insert(int index);
+	void readInitialValues(unsigned int shaderProgram, const UniformInfo& info);
+
+public:
+	static const int INVALID_HANDLE = -1;
+
+	void build(unsigned int shaderProgram);
+	void clear();
+
+	int find(const char* name) const;
+	int find(const std::string& name) const { return find(name.c_str()); }
+
+	int getLocation(int handle) const { return handle < 0 ? -1 : uniforms[handle].location; }
+	const UniformInfo& getInfo(int handle) const { return uniforms[handle]; }
+	int getUniformCount() const { return (int)uniforms.size(); }
+
+	// Copies count elements of valueType into the shadow block starting at array element firstElement.
+	// Elements past the end of the array are dropped, and a type that doesn't match the uniform is
+	// reported once and ignored.
+	void write(int handle, GLenum valueType, const void* values, int firstElement, int count, UniformUploadStats& stats);
+	// Uploads every dirty range that differs from the program's current values. The program has to be
+	// the one in use.
+	void flush(UniformUploadStats& stats);
+	bool isDirty() const { return !dirty.empty(); }
+};
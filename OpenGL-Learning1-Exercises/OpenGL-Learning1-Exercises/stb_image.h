@@ -262,7 +262,10 @@ RECENT REVISION HISTORY:
 // code.)
 //
 // On x86, SSE2 will automatically be used when available based on a run-time
-// test; if not, the generic C versions are used as a fall-back. On ARM targets,
+// test; if not, the generic C versions are used as a fall-back. On x64, AVX2
+// versions of the same kernels are compiled in as well and used instead when
+// cpuid reports AVX2, whatever instruction set the rest of the build targets;
+// define STBI_NO_AVX2 to leave them out. On ARM targets,
 // the typical path is to have separate builds for NEON and non-NEON devices
 // (at least this is true for iOS and Android). Therefore, the NEON support is
 // toggled by a build flag: define STBI_NEON to get NEON loops.
@@ -514,6 +517,13 @@ STBIDEF void stbi_convert_iphone_png_to_rgb(int flag_true_if_should_convert);
 // flip the image vertically, so the first pixel in the output array is the bottom left
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
+// limit the JPEG decoder's kernels to level 0 (generic C), 1 (SSE2/NEON) or
+// 2 (AVX2), e.g. to benchmark them against each other; the default is 2. every
+// level decodes to exactly the same pixels. returns the level jpegs will
+// actually be decoded with on this machine. not thread-safe: call it while no
+// jpeg is being loaded.
+STBIDEF int stbi_set_jpeg_simd_level(int max_level);
+
 // as above, but only applies to images loaded on the thread that calls the function
 // this function is only available if your compiler supports thread-local variables;
 // calling it will fail to link if your compiler doesn't
@@ -771,6 +781,41 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// AVX2 kernels for x64. they are compiled with a target attribute rather than
+// relying on -mavx2, so an SSE2 build still gets them, and are only selected
+// after a run-time check (see stbi__setup_jpeg).
+#if defined(STBI_SSE2) && defined(STBI__X64_TARGET) && !defined(STBI_NO_AVX2) && !defined(STBI_NO_JPEG) \
+   && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || (defined(_MSC_VER) && _MSC_VER >= 1800))
+#define STBI_AVX2
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define STBI__AVX2_TARGET
+#endif
+
+static int stbi__avx2_available(void)
+{
+#ifdef _MSC_VER
+   int info[4];
+   __cpuid(info,0);
+   if (info[0] < 7)
+      return 0;
+   // the OS must save ymm registers too: OSXSAVE and AVX, and xmm+ymm state in XCR0
+   __cpuid(info,1);
+   if ((info[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6)
+      return 0;
+   __cpuidex(info,7,0);
+   return ((info[1] >> 5) & 1) != 0;
+#else
+   // checks OS support for the ymm state as well
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -1907,7 +1952,7 @@ static stbi_uc *stbi__hdr_to_ldr(float   *data, int x, int y, int comp)
 //      - quality integer IDCT derived from IJG's 'slow'
 //    performance
 //      - fast huffman; reasonable integer IDCT
-//      - some SIMD kernels for common paths on targets with SSE2/NEON
+//      - some SIMD kernels for common paths on targets with SSE2/AVX2/NEON
 //      - uses a lot of intermediate memory, could cache poorly
 
 #ifndef STBI_NO_JPEG
@@ -2670,6 +2715,170 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 
 #endif // STBI_SSE2
 
+#ifdef STBI_AVX2
+// avx2 integer IDCT, bit-identical to stbi__idct_simd and so to the generic C
+// version. the sse2 one spends most of its time interleaving rows for
+// _mm_madd_epi16 and transposing. here each register holds the interleaved
+// pairs of two rows (row k and row k+4) for all 8 columns, which is what the
+// multiplies want directly, and the transposes build that layout from the
+// output of the previous pass in 256-bit steps.
+STBI__AVX2_TARGET static void stbi__idct_avx2(stbi_uc *out, int out_stride, short data[64])
+{
+   __m256i p04, p15, p26, p37;
+   __m256i q07, q16, q25, q34;
+
+   // dot product constant: even elems=x, odd elems=y
+   #define dct_const(x,y)  _mm256_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y))
+
+   // butterfly a/b, add bias, then shift by "s" and pack. the pack works
+   // within lanes: out = a+b then a-b for columns 0-3 | the same for 4-7
+   #define dct_bfly32o(out, a,b,bias,s) \
+      { \
+         __m256i abiased = _mm256_add_epi32(a, bias); \
+         __m256i sum = _mm256_srai_epi32(_mm256_add_epi32(abiased, b), s); \
+         __m256i dif = _mm256_srai_epi32(_mm256_sub_epi32(abiased, b), s); \
+         out = _mm256_packs_epi32(sum, dif); \
+      }
+
+   // one 1-D pass over p04, p15, p26, p37, where pXY interleaves rows X and Y.
+   // rows 1 and 5 come in that order, so rot3 takes its constants swapped;
+   // rows 3 and 7 are swapped to 7, 3 so that p15 + p73 is sum17, sum35.
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         __m256i t2e = _mm256_madd_epi16(p26, rot0_0); \
+         __m256i t3e = _mm256_madd_epi16(p26, rot0_1); \
+         __m256i p40 = _mm256_shuffle_epi8(p04, swap16); \
+         __m256i t0e = _mm256_madd_epi16(_mm256_add_epi16(p04, p40), widen); \
+         __m256i t1e = _mm256_madd_epi16(_mm256_sub_epi16(p04, p40), widen); \
+         __m256i x0 = _mm256_add_epi32(t0e, t3e); \
+         __m256i x3 = _mm256_sub_epi32(t0e, t3e); \
+         __m256i x1 = _mm256_add_epi32(t1e, t2e); \
+         __m256i x2 = _mm256_sub_epi32(t1e, t2e); \
+         /* odd part */ \
+         __m256i p73 = _mm256_shuffle_epi8(p37, swap16); \
+         __m256i y0o = _mm256_madd_epi16(p73, rot2_0); \
+         __m256i y2o = _mm256_madd_epi16(p73, rot2_1); \
+         __m256i y1o = _mm256_madd_epi16(p15, rot3_0); \
+         __m256i y3o = _mm256_madd_epi16(p15, rot3_1); \
+         __m256i sums = _mm256_add_epi16(p15, p73); \
+         __m256i y4o = _mm256_madd_epi16(sums, rot1_0); \
+         __m256i y5o = _mm256_madd_epi16(sums, rot1_1); \
+         __m256i x4 = _mm256_add_epi32(y0o, y4o); \
+         __m256i x5 = _mm256_add_epi32(y1o, y5o); \
+         __m256i x6 = _mm256_add_epi32(y2o, y5o); \
+         __m256i x7 = _mm256_add_epi32(y3o, y4o); \
+         dct_bfly32o(q07, x0,x7,bias,shift); \
+         dct_bfly32o(q16, x1,x6,bias,shift); \
+         dct_bfly32o(q25, x2,x5,bias,shift); \
+         dct_bfly32o(q34, x3,x4,bias,shift); \
+      }
+
+   __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+   __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f( 0.765366865f), stbi__f2f(0.5411961f));
+   __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+   __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+   __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f( 0.298631336f), stbi__f2f(-1.961570560f));
+   __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f( 3.072711026f));
+   __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f( 2.053119869f));
+   __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f( 1.501321110f), stbi__f2f(-0.390180644f));
+   // x << 12 of the even elements; the sums and differences of rows 0 and 4
+   // are formed in 16 bits first, like the sse2 version does
+   __m256i widen = dct_const(4096, 0);
+   __m256i swap16 = _mm256_setr_epi8(2,3,0,1, 6,7,4,5, 10,11,8,9, 14,15,12,13, 2,3,0,1, 6,7,4,5, 10,11,8,9, 14,15,12,13);
+
+   // rounding biases in column/row passes, see stbi__idct_block for explanation.
+   __m256i bias_0 = _mm256_set1_epi32(512);
+   __m256i bias_1 = _mm256_set1_epi32(65536 + (128<<17));
+
+   {
+      // load two rows per register, then interleave row k with row k+4;
+      // the unpacks give columns 0-3 of two pairs, then columns 4-7
+      __m256i r01 = _mm256_loadu_si256((const __m256i *) (data + 0*8));
+      __m256i r23 = _mm256_loadu_si256((const __m256i *) (data + 2*8));
+      __m256i r45 = _mm256_loadu_si256((const __m256i *) (data + 4*8));
+      __m256i r67 = _mm256_loadu_si256((const __m256i *) (data + 6*8));
+      __m256i lo0 = _mm256_unpacklo_epi16(r01, r45);
+      __m256i hi0 = _mm256_unpackhi_epi16(r01, r45);
+      __m256i lo1 = _mm256_unpacklo_epi16(r23, r67);
+      __m256i hi1 = _mm256_unpackhi_epi16(r23, r67);
+      p04 = _mm256_permute2x128_si256(lo0, hi0, 0x20);
+      p15 = _mm256_permute2x128_si256(lo0, hi0, 0x31);
+      p26 = _mm256_permute2x128_si256(lo1, hi1, 0x20);
+      p37 = _mm256_permute2x128_si256(lo1, hi1, 0x31);
+   }
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // transpose. q07 holds row 0 then row 7 for columns 0-3 | 4-7, and so on.
+      // first pair every column c with column c+4 within each row:
+      // u0 = row 0 | row 3, u7 = row 7 | row 4, u1 = row 1 | row 2, u6 = row 6 | row 5
+      __m256i s0 = _mm256_permute2x128_si256(q07, q34, 0x20);
+      __m256i t0 = _mm256_permute2x128_si256(q07, q34, 0x31);
+      __m256i s1 = _mm256_permute2x128_si256(q16, q25, 0x20);
+      __m256i t1 = _mm256_permute2x128_si256(q16, q25, 0x31);
+      __m256i u0 = _mm256_unpacklo_epi16(s0, t0);
+      __m256i u7 = _mm256_unpackhi_epi16(s0, t0);
+      __m256i u1 = _mm256_unpacklo_epi16(s1, t1);
+      __m256i u6 = _mm256_unpackhi_epi16(s1, t1);
+
+      // rows 0-3 in the low lanes, 4-7 in the high ones
+      __m256i w04 = _mm256_permute2x128_si256(u0, u7, 0x30);
+      __m256i w37 = _mm256_permute2x128_si256(u0, u7, 0x21);
+      __m256i w15 = _mm256_permute2x128_si256(u1, u6, 0x30);
+      __m256i w26 = _mm256_permute2x128_si256(u1, u6, 0x21);
+
+      // then a 4x4 transpose of the 32-bit column pairs
+      __m256i a = _mm256_unpacklo_epi32(w04, w15);
+      __m256i b = _mm256_unpacklo_epi32(w26, w37);
+      __m256i c = _mm256_unpackhi_epi32(w04, w15);
+      __m256i d = _mm256_unpackhi_epi32(w26, w37);
+      p04 = _mm256_unpacklo_epi64(a, b);
+      p15 = _mm256_unpackhi_epi64(a, b);
+      p26 = _mm256_unpacklo_epi64(c, d);
+      p37 = _mm256_unpackhi_epi64(c, d);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      // q07 now holds output columns 0 and 7 for rows 0-3 | rows 4-7. in
+      // bytes, e has columns 0, 7, 1, 6 and f columns 2, 5, 3, 4, four rows
+      // each; gather two rows of all 8 columns per lane from them
+      __m256i e = _mm256_packus_epi16(q07, q16);
+      __m256i f = _mm256_packus_epi16(q25, q34);
+      __m256i e01 = _mm256_setr_epi8(0,8,-1,-1,-1,-1,12,4, 1,9,-1,-1,-1,-1,13,5, 0,8,-1,-1,-1,-1,12,4, 1,9,-1,-1,-1,-1,13,5);
+      __m256i f01 = _mm256_setr_epi8(-1,-1,0,8,12,4,-1,-1, -1,-1,1,9,13,5,-1,-1, -1,-1,0,8,12,4,-1,-1, -1,-1,1,9,13,5,-1,-1);
+      __m256i e23 = _mm256_setr_epi8(2,10,-1,-1,-1,-1,14,6, 3,11,-1,-1,-1,-1,15,7, 2,10,-1,-1,-1,-1,14,6, 3,11,-1,-1,-1,-1,15,7);
+      __m256i f23 = _mm256_setr_epi8(-1,-1,2,10,14,6,-1,-1, -1,-1,3,11,15,7,-1,-1, -1,-1,2,10,14,6,-1,-1, -1,-1,3,11,15,7,-1,-1);
+      __m256i o0145 = _mm256_or_si256(_mm256_shuffle_epi8(e, e01), _mm256_shuffle_epi8(f, f01));
+      __m256i o2367 = _mm256_or_si256(_mm256_shuffle_epi8(e, e23), _mm256_shuffle_epi8(f, f23));
+      __m128i o01 = _mm256_castsi256_si128(o0145);
+      __m128i o45 = _mm256_extracti128_si256(o0145, 1);
+      __m128i o23 = _mm256_castsi256_si128(o2367);
+      __m128i o67 = _mm256_extracti128_si256(o2367, 1);
+
+      // store
+      _mm_storel_epi64((__m128i *) out, o01); out += out_stride;
+      _mm_storeh_pd((double *) out, _mm_castsi128_pd(o01)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, o23); out += out_stride;
+      _mm_storeh_pd((double *) out, _mm_castsi128_pd(o23)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, o45); out += out_stride;
+      _mm_storeh_pd((double *) out, _mm_castsi128_pd(o45)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, o67); out += out_stride;
+      _mm_storeh_pd((double *) out, _mm_castsi128_pd(o67));
+   }
+
+#undef dct_const
+#undef dct_bfly32o
+#undef dct_pass
+}
+
+#endif // STBI_AVX2
+
 #ifdef STBI_NEON
 
 // NEON integer IDCT. should produce bit-identical
@@ -3589,6 +3798,85 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// the sse2 filter above on 16 pixels at a time. the shifts by one pixel cross
+// the 128-bit lanes, so they are a lane permute plus an alignr.
+STBI__AVX2_TARGET static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   // need to generate 2x2 samples for every one in input
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   // as in the sse2 version, the last pixel of a row is left to the
+   // scalar loop because of the filter boundary conditions.
+   for (; i < ((w-1) & ~15); i += 16) {
+      // load and perform the vertical filtering pass
+      // this uses 3*x + y = 4*x + (y - x)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i diff  = _mm256_sub_epi16(farw, nearw);
+      __m256i nears = _mm256_slli_epi16(nearw, 2);
+      __m256i curr  = _mm256_add_epi16(nears, diff); // current row
+
+      // "prev" is current row shifted right by 1 pixel with t1 in the gap,
+      // "next" is current row shifted left by 1 pixel with the first pixel
+      // of the next block of 16 in the gap. the lane the alignr pulls from
+      // comes from the permutes, which zero the pixel the gap ends up in.
+      __m256i prv0 = _mm256_alignr_epi8(curr, _mm256_permute2x128_si256(curr, curr, 0x08), 14);
+      __m256i nxt0 = _mm256_alignr_epi8(_mm256_permute2x128_si256(curr, curr, 0x81), curr, 2);
+      __m256i prev = _mm256_or_si256(prv0, _mm256_setr_epi32(t1, 0, 0, 0, 0, 0, 0, 0));
+      __m256i next = _mm256_or_si256(nxt0, _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 0, (3*in_near[i+16] + in_far[i+16]) << 16));
+
+      // horizontal filter, polyphase implementation since it's convenient:
+      // even pixels = 3*cur + prev = cur*4 + (prev - cur)
+      // odd  pixels = 3*cur + next = cur*4 + (next - cur)
+      // note the shared term.
+      __m256i bias  = _mm256_set1_epi16(8);
+      __m256i curs = _mm256_slli_epi16(curr, 2);
+      __m256i prvd = _mm256_sub_epi16(prev, curr);
+      __m256i nxtd = _mm256_sub_epi16(next, curr);
+      __m256i curb = _mm256_add_epi16(curs, bias);
+      __m256i even = _mm256_add_epi16(prvd, curb);
+      __m256i odd  = _mm256_add_epi16(nxtd, curb);
+
+      // interleave even and odd pixels, then undo scaling. the unpacks and
+      // the pack work within lanes, so their orders cancel out.
+      __m256i int0 = _mm256_unpacklo_epi16(even, odd);
+      __m256i int1 = _mm256_unpackhi_epi16(even, odd);
+      __m256i de0  = _mm256_srli_epi16(int0, 4);
+      __m256i de1  = _mm256_srli_epi16(int1, 4);
+
+      // pack and write output
+      __m256i outv = _mm256_packus_epi16(de0, de1);
+      _mm256_storeu_si256((__m256i *) (out + i*2), outv);
+
+      // "previous" value for next iter
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
    // resample with nearest-neighbor
@@ -3763,26 +4051,141 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+STBI__AVX2_TARGET static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   // the sse2 loop on 16 pixels at a time, which leaves the rest to it. with
+   // pshufb, step == 3 is only a compaction of the step == 4 result.
+   if (step == 4 || step == 3) {
+      __m128i signflip  = _mm_set1_epi8(-0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+      __m256i drop_alpha = _mm256_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1, 0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+
+      for (; i+15 < count; i += 16) {
+         // load
+         __m128i y_bytes = _mm_loadu_si128((__m128i *) (y+i));
+         __m128i cr_bytes = _mm_loadu_si128((__m128i *) (pcr+i));
+         __m128i cb_bytes = _mm_loadu_si128((__m128i *) (pcb+i));
+         __m128i cr_biased = _mm_xor_si128(cr_bytes, signflip); // -128
+         __m128i cb_biased = _mm_xor_si128(cb_bytes, signflip); // -128
+
+         // widen to short with the byte in the high half, like the sse2 unpacks
+         __m256i yw  = _mm256_or_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(y_bytes), 8), y_bias);
+         __m256i crw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cr_biased), 8);
+         __m256i cbw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cb_biased), 8);
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte, set up for transpose
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+
+         // transpose to interleave channels; within lanes, so o0 holds
+         // pixels 0-3 and 8-11, o1 pixels 4-7 and 12-15
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         // store
+         if (step == 4) {
+            _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+            _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+            out += 64;
+         } else {
+            // 12 bytes per group of 4 pixels, butted together into 48
+            __m256i c0 = _mm256_shuffle_epi8(o0, drop_alpha);
+            __m256i c1 = _mm256_shuffle_epi8(o1, drop_alpha);
+            __m128i p0 = _mm256_castsi256_si128(c0);
+            __m128i p4 = _mm256_castsi256_si128(c1);
+            __m128i p8 = _mm256_extracti128_si256(c0, 1);
+            __m128i p12 = _mm256_extracti128_si256(c1, 1);
+            _mm_storeu_si128((__m128i *) (out + 0), _mm_or_si128(p0, _mm_slli_si128(p4, 12)));
+            _mm_storeu_si128((__m128i *) (out + 16), _mm_or_si128(_mm_srli_si128(p4, 4), _mm_slli_si128(p8, 8)));
+            _mm_storeu_si128((__m128i *) (out + 32), _mm_or_si128(_mm_srli_si128(p8, 8), _mm_slli_si128(p12, 4)));
+            out += 48;
+         }
+      }
+   }
+
+   stbi__YCbCr_to_RGB_simd(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif
+
+static int stbi__jpeg_simd_level = 2;
+
+// the highest kernel level up to max_level this machine can run
+static int stbi__jpeg_simd_usable(int max_level)
+{
+#ifdef STBI_AVX2
+   if (max_level >= 2 && stbi__avx2_available())
+      return 2;
+#endif
+#ifdef STBI_SSE2
+   if (max_level >= 1 && stbi__sse2_available())
+      return 1;
+#endif
+#ifdef STBI_NEON
+   if (max_level >= 1)
+      return 1;
+#endif
+   STBI_NOTUSED(max_level);
+   return 0;
+}
+
+STBIDEF int stbi_set_jpeg_simd_level(int max_level)
+{
+   stbi__jpeg_simd_level = max_level;
+   return stbi__jpeg_simd_usable(max_level);
+}
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
+   int level = stbi__jpeg_simd_usable(stbi__jpeg_simd_level);
+
    j->idct_block_kernel = stbi__idct_block;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
 
-#ifdef STBI_SSE2
-   if (stbi__sse2_available()) {
+#if defined(STBI_SSE2) || defined(STBI_NEON)
+   if (level >= 1) {
       j->idct_block_kernel = stbi__idct_simd;
       j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
       j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
    }
 #endif
 
-#ifdef STBI_NEON
-   j->idct_block_kernel = stbi__idct_simd;
-   j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
-   j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+#ifdef STBI_AVX2
+   if (level >= 2) {
+      j->idct_block_kernel = stbi__idct_avx2;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+   }
 #endif
+
+   STBI_NOTUSED(level);
 }
 
 // clean up the temporary component buffers